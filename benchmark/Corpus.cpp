@@ -0,0 +1,147 @@
+#include "Corpus.h"
+
+#include <cstdint>
+#include <stdexcept>
+
+namespace yoko {
+namespace bench {
+
+namespace {
+
+const std::size_t deep_depth = 256;
+
+// 固定种子的线性同余生成器，保证每次生成的文档一样
+class Rand {
+public:
+    uint32_t next() {
+        m_state = m_state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return static_cast<uint32_t>(m_state >> 33);
+    }
+    uint32_t next(uint32_t n) { return next() % n; }
+
+private:
+    uint64_t m_state = 42;
+};
+
+const char *const words[] = {
+    "lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing", "elit",
+    "sed", "do", "eiusmod", "tempor", "incididunt", "ut", "labore", "et", "dolore", "magna"
+};
+
+void append_words(std::string &out, Rand &rand, std::size_t len) {
+    std::size_t end = out.size() + len;
+    while (out.size() < end) {
+        out += words[rand.next(sizeof(words) / sizeof(words[0]))];
+        out += ' ';
+    }
+}
+
+void append_deep(std::string &out, Rand &rand) {
+    for (std::size_t i = 0; i < deep_depth; ++i) {
+        out += "<level depth=\"";
+        out += std::to_string(i);
+        out += "\">";
+    }
+    out += words[rand.next(sizeof(words) / sizeof(words[0]))];
+    for (std::size_t i = 0; i < deep_depth; ++i) {
+        out += "</level>";
+    }
+    out += '\n';
+}
+
+void append_wide(std::string &out, Rand &rand, std::size_t idx) {
+    out += "  <item>";
+    out += std::to_string(idx);
+    out += ' ';
+    out += words[rand.next(sizeof(words) / sizeof(words[0]))];
+    out += "</item>\n";
+}
+
+void append_attrs(std::string &out, Rand &rand, std::size_t idx) {
+    out += "  <record id=\"";
+    out += std::to_string(idx);
+    out += '"';
+    static const char *const keys[] = {"name", "type", "owner", "group", "mode", "size", "state"};
+    for (const char *key : keys) {
+        out += ' ';
+        out += key;
+        out += "=\"";
+        out += words[rand.next(sizeof(words) / sizeof(words[0]))];
+        out += '"';
+    }
+    out += "/>\n";
+}
+
+void append_text(std::string &out, Rand &rand, std::size_t idx) {
+    out += "  <para n=\"";
+    out += std::to_string(idx);
+    out += "\">";
+    append_words(out, rand, 1024);
+    out += "</para>\n";
+}
+
+void append_comments(std::string &out, Rand &rand, std::size_t idx) {
+    for (int i = 0; i < 3; ++i) {
+        out += "  <!-- ";
+        append_words(out, rand, 48);
+        out += "-->\n";
+    }
+    out += "  <entry>";
+    out += std::to_string(idx);
+    out += "</entry>\n";
+}
+
+}
+
+const std::vector<Shape> &all_shapes() {
+    static const std::vector<Shape> shapes{Shape::DEEP, Shape::WIDE, Shape::ATTRS, Shape::TEXT, Shape::COMMENTS};
+    return shapes;
+}
+
+const char *shape_name(Shape shape) {
+    switch (shape) {
+    case Shape::DEEP: return "deep";
+    case Shape::WIDE: return "wide";
+    case Shape::ATTRS: return "attrs";
+    case Shape::TEXT: return "text";
+    case Shape::COMMENTS: return "comments";
+    }
+    return "unknown";
+}
+
+Shape shape_from_name(const std::string &name) {
+    for (Shape shape : all_shapes()) {
+        if (name == shape_name(shape)) {
+            return shape;
+        }
+    }
+    throw std::invalid_argument("unknown shape: " + name);
+}
+
+std::string generate(Shape shape, std::size_t size) {
+    static const char head[] = "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n<corpus>\n";
+    static const char tail[] = "</corpus>\n";
+
+    Rand rand;
+    std::string out;
+    out.reserve(size + 16 * 1024);
+    out += head;
+    std::size_t body = size > sizeof(head) + sizeof(tail) ? size - sizeof(tail) : 0;
+    std::size_t idx = 0;
+    // 至少生成一个子结点
+    do {
+        switch (shape) {
+        case Shape::DEEP: append_deep(out, rand); break;
+        case Shape::WIDE: append_wide(out, rand, idx); break;
+        case Shape::ATTRS: append_attrs(out, rand, idx); break;
+        case Shape::TEXT: append_text(out, rand, idx); break;
+        case Shape::COMMENTS: append_comments(out, rand, idx); break;
+        }
+        ++idx;
+    } while (out.size() < body);
+    out += tail;
+    return out;
+}
+
+}
+}
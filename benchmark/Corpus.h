@@ -0,0 +1,31 @@
+#ifndef __YOKO_CORPUS_H__
+#define __YOKO_CORPUS_H__
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace yoko {
+namespace bench {
+
+// 合成测试文档的形状
+enum class Shape {
+    DEEP,       // 深层嵌套：根结点下是一条条256层的嵌套链
+    WIDE,       // 根结点下大量只有短文本的兄弟结点
+    ATTRS,      // 每个标签带8个属性，没有文本
+    TEXT,       // 每个标签带一段1KB左右的长文本
+    COMMENTS    // 标签之间夹着大量注释
+};
+
+const std::vector<Shape> &all_shapes();
+const char *shape_name(Shape shape);
+// 按名字查找，找不到时抛出std::invalid_argument
+Shape shape_from_name(const std::string &name);
+
+// 生成大约size字节、合法的xml文档，同样的参数每次生成的内容都一样
+std::string generate(Shape shape, std::size_t size);
+
+}
+}
+
+#endif
@@ -0,0 +1,296 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <utility>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "Corpus.h"
+#include "../xml_parser/Bind.h"
+#include "../xml_parser/Xml.h"
+
+// 解析器的性能测试：5种形状的合成文档，大小从1KB开始每次乘32，
+// 分别测loadString、loadFile、loadSnapshot（都分COPY/VIEW）、print和Node::to_string，
+// attrs形状另外比较建树后取属性（walk）和直接绑定到结构体（bind），
+// 除了吞吐量还报告每MB文档的分配次数allocs_per_MB和进程到目前为止的峰值RSS peak_rss_MB。
+//     bin/xml_bench --benchmark_filter=wide
+//     YOKO_BENCH_MAX_MB=1024 bin/xml_bench     包括1GB的文档
+// 用Release模式编译，Debug模式下的数字没有参考价值
+
+using namespace yoko;
+using namespace yoko::bench;
+
+// ATTRS形状的一条记录，比较绑定和"建树再取属性转换"两种做法
+struct Record {
+    long id = 0;
+    std::string name;
+    std::string type;
+    std::string owner;
+};
+
+template <>
+struct yoko::bind::Schema<Record> {
+    static constexpr Field fields[] = {
+        attr<&Record::id>("id"),
+        attr<&Record::name>("name"),
+        attr<&Record::type>("type"),
+        attr<&Record::owner>("owner"),
+    };
+};
+
+// 统计全局operator new的调用次数，用来计算每MB的分配次数
+static std::atomic<uint64_t> g_allocs(0);
+
+void *operator new(std::size_t n) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    void *p = std::malloc(n ? n : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new[](std::size_t n) {
+    return operator new(n);
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+const std::size_t KB = 1024;
+const std::size_t MB = 1024 * KB;
+const std::size_t GB = 1024 * MB;
+
+// 默认只跑到64MB，1GB的文档要几GB内存，设置YOKO_BENCH_MAX_MB才跑
+std::size_t max_size() {
+    const char *env = std::getenv("YOKO_BENCH_MAX_MB");
+    return env ? std::strtoull(env, nullptr, 10) * MB : 64 * MB;
+}
+
+const std::string &corpus(Shape shape, std::size_t size) {
+    static std::map<std::pair<Shape, std::size_t>, std::string> cache;
+    auto &doc = cache[std::make_pair(shape, size)];
+    if (doc.empty()) {
+        doc = generate(shape, size);
+    }
+    return doc;
+}
+
+// loadFile用的临时文件，进程退出时删除
+class TempFile {
+public:
+    explicit TempFile(const std::string &content) {
+        char path[] = "/tmp/yoko_bench_XXXXXX";
+        int fd = mkstemp(path);
+        if (fd < 0) {
+            throw std::runtime_error("mkstemp failed");
+        }
+        m_path = path;
+        std::size_t off = 0;
+        while (off < content.size()) {
+            ssize_t n = ::write(fd, content.data() + off, content.size() - off);
+            if (n <= 0) {
+                ::close(fd);
+                throw std::runtime_error("write failed");
+            }
+            off += n;
+        }
+        ::close(fd);
+    }
+    ~TempFile() { ::unlink(m_path.c_str()); }
+    const std::string &path() const { return m_path; }
+
+private:
+    std::string m_path;
+};
+
+const std::string &corpus_file(Shape shape, std::size_t size) {
+    static std::map<std::pair<Shape, std::size_t>, std::unique_ptr<TempFile>> cache;
+    auto &file = cache[std::make_pair(shape, size)];
+    if (!file) {
+        file.reset(new TempFile(corpus(shape, size)));
+    }
+    return file->path();
+}
+
+// 同一篇文档的快照文件
+const std::string &snapshot_file(Shape shape, std::size_t size) {
+    static std::map<std::pair<Shape, std::size_t>, std::unique_ptr<TempFile>> cache;
+    auto &file = cache[std::make_pair(shape, size)];
+    if (!file) {
+        file.reset(new TempFile(std::string()));
+        Xml xml;
+        xml.loadString(corpus(shape, size), Xml::Mode::VIEW);
+        xml.saveSnapshot(file->path());
+    }
+    return file->path();
+}
+
+// print()写到std::cout，测量时换成丢弃所有输出的streambuf
+class NullBuf : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char *, std::streamsize n) override { return n; }
+};
+
+long peak_rss_kb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// 计时之外统计分配次数，最后换算成MB/s、每MB分配次数和进程的峰值RSS
+template <typename F>
+void run(benchmark::State &state, std::size_t bytes, F &&f) {
+    uint64_t allocs = 0;
+    for (auto _ : state) {
+        uint64_t before = g_allocs.load(std::memory_order_relaxed);
+        f();
+        allocs += g_allocs.load(std::memory_order_relaxed) - before;
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * bytes);
+    double mbs = static_cast<double>(bytes) * state.iterations() / MB;
+    state.counters["allocs_per_MB"] = benchmark::Counter(allocs / mbs);
+    state.counters["peak_rss_MB"] = benchmark::Counter(peak_rss_kb() / 1024.0);
+}
+
+void bm_load_string(benchmark::State &state, Shape shape, std::size_t size, Xml::Mode mode) {
+    const std::string &doc = corpus(shape, size);
+    run(state, doc.size(), [&]() {
+        Xml xml;
+        xml.loadString(doc, mode);
+        benchmark::DoNotOptimize(&xml);
+    });
+}
+
+void bm_load_file(benchmark::State &state, Shape shape, std::size_t size, Xml::Mode mode) {
+    const std::string &path = corpus_file(shape, size);
+    std::size_t bytes = corpus(shape, size).size();
+    run(state, bytes, [&]() {
+        Xml xml;
+        xml.loadFile(path, mode);
+        benchmark::DoNotOptimize(&xml);
+    });
+}
+
+// 和loadFile对比：同一篇文档从快照加载，吞吐量仍然按xml文档的大小计算
+void bm_load_snapshot(benchmark::State &state, Shape shape, std::size_t size, Xml::Mode mode) {
+    const std::string &path = snapshot_file(shape, size);
+    std::size_t bytes = corpus(shape, size).size();
+    run(state, bytes, [&]() {
+        Xml xml;
+        xml.loadSnapshot(path, mode);
+        benchmark::DoNotOptimize(&xml);
+    });
+}
+
+void bm_print(benchmark::State &state, Shape shape, std::size_t size) {
+    const std::string &doc = corpus(shape, size);
+    Xml xml;
+    xml.loadString(doc);
+    NullBuf null;
+    std::streambuf *old = std::cout.rdbuf(&null);
+    run(state, doc.size(), [&]() { xml.print(); });
+    std::cout.rdbuf(old);
+}
+
+void bm_to_string(benchmark::State &state, Shape shape, std::size_t size) {
+    const std::string &doc = corpus(shape, size);
+    Xml xml;
+    xml.loadString(doc);
+    run(state, doc.size(), [&]() {
+        std::string out = xml.get_root().to_string();
+        benchmark::DoNotOptimize(out.data());
+    });
+}
+
+void bm_walk(benchmark::State &state, Shape shape, std::size_t size) {
+    const std::string &doc = corpus(shape, size);
+    run(state, doc.size(), [&]() {
+        Xml xml;
+        xml.loadString(doc);
+        std::vector<Record> records;
+        for (const Node &node : xml.get_root()) {
+            Record rec;
+            rec.id = atol(node.get_attr("id").value_or("0").c_str());
+            rec.name = node.get_attr("name").value_or("");
+            rec.type = node.get_attr("type").value_or("");
+            rec.owner = node.get_attr("owner").value_or("");
+            records.push_back(std::move(rec));
+        }
+        benchmark::DoNotOptimize(records.data());
+    });
+}
+
+void bm_bind(benchmark::State &state, Shape shape, std::size_t size) {
+    const std::string &doc = corpus(shape, size);
+    run(state, doc.size(), [&]() {
+        std::vector<Record> records = bind::load_string<Record>(doc, "record");
+        benchmark::DoNotOptimize(records.data());
+    });
+}
+
+std::string size_name(std::size_t size) {
+    if (size >= GB) {
+        return std::to_string(size / GB) + "GB";
+    }
+    if (size >= MB) {
+        return std::to_string(size / MB) + "MB";
+    }
+    return std::to_string(size / KB) + "KB";
+}
+
+}
+
+int main(int argc, char **argv) {
+    std::size_t limit = max_size();
+    for (Shape shape : all_shapes()) {
+        for (std::size_t size = KB; size <= GB && size <= limit; size *= 32) {
+            std::string suffix = std::string("/") + shape_name(shape) + "/" + size_name(size);
+            benchmark::RegisterBenchmark(("loadString_copy" + suffix).c_str(), bm_load_string, shape, size, Xml::Mode::COPY);
+            benchmark::RegisterBenchmark(("loadString_view" + suffix).c_str(), bm_load_string, shape, size, Xml::Mode::VIEW);
+            benchmark::RegisterBenchmark(("loadFile_copy" + suffix).c_str(), bm_load_file, shape, size, Xml::Mode::COPY);
+            benchmark::RegisterBenchmark(("loadFile_view" + suffix).c_str(), bm_load_file, shape, size, Xml::Mode::VIEW);
+            benchmark::RegisterBenchmark(("loadSnapshot_copy" + suffix).c_str(), bm_load_snapshot, shape, size, Xml::Mode::COPY);
+            benchmark::RegisterBenchmark(("loadSnapshot_view" + suffix).c_str(), bm_load_snapshot, shape, size, Xml::Mode::VIEW);
+            benchmark::RegisterBenchmark(("print" + suffix).c_str(), bm_print, shape, size);
+            benchmark::RegisterBenchmark(("to_string" + suffix).c_str(), bm_to_string, shape, size);
+            if (shape == Shape::ATTRS) {
+                benchmark::RegisterBenchmark(("walk" + suffix).c_str(), bm_walk, shape, size);
+                benchmark::RegisterBenchmark(("bind" + suffix).c_str(), bm_bind, shape, size);
+            }
+        }
+    }
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
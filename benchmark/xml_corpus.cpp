@@ -0,0 +1,33 @@
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+#include "Corpus.h"
+
+using namespace yoko::bench;
+
+// 生成测试文档：xml_corpus <deep|wide|attrs|text|comments> <大小，字节> [输出文件]
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        std::cerr << "usage: " << argv[0] << " <deep|wide|attrs|text|comments> <bytes> [file]" << std::endl;
+        return 1;
+    }
+
+    try {
+        std::string doc = generate(shape_from_name(argv[1]), std::strtoull(argv[2], nullptr, 10));
+        if (argc > 3) {
+            std::ofstream ofs(argv[3], std::ios::binary);
+            ofs.write(doc.data(), doc.size());
+            if (!ofs) {
+                std::cerr << "write " << argv[3] << " failed" << std::endl;
+                return 1;
+            }
+        } else {
+            std::cout.write(doc.data(), doc.size());
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,193 @@
+#include "AsyncExecutor.h"
+
+#include <exception>
+#include <iostream>
+#include <sys/epoll.h>
+
+using namespace yoko;
+
+struct AsyncExecutor::Operation {
+    enum Phase {
+        QUERY,  // mysql_real_query
+        STORE   // mysql_store_result
+    };
+
+    EventLoop *loop;
+    std::shared_ptr<Connection> conn;
+    std::string sql;
+    Callback callback;
+    Phase phase = QUERY;
+    int fd = -1;
+    int err = 0;
+    MYSQL_RES *res = nullptr;
+    EventLoop::TimerId timer = 0;
+    bool started = false;
+    bool done = false;
+
+    // 执行器析构时丢弃的操作可能正停在_start/_cont中间，连接上还有没读完的数据，
+    // 不能再给别人用，标记之后连接池会关闭它
+    ~Operation() {
+        if (started && !done && conn) {
+            conn->setBroken();
+        }
+    }
+};
+
+AsyncExecutor::AsyncExecutor(int threads) : next_(0) {
+    if (threads < 1) {
+        threads = 1;
+    }
+    for (int i = 0; i < threads; ++i) {
+        loops_.emplace_back(new EventLoop());
+    }
+    for (auto &loop : loops_) {
+        EventLoop *p = loop.get();
+        threads_.emplace_back([p] { p->loop(); });
+    }
+}
+
+AsyncExecutor::~AsyncExecutor() {
+    for (auto &loop : loops_) {
+        loop->quit();
+    }
+    for (auto &t : threads_) {
+        t.join();
+    }
+}
+
+void AsyncExecutor::execute(std::shared_ptr<Connection> conn, std::string sql, Callback callback) {
+    auto op = std::make_shared<Operation>();
+    op->loop = loops_[next_++ % loops_.size()].get();
+    op->conn = std::move(conn);
+    op->sql = std::move(sql);
+    op->callback = std::move(callback);
+    op->loop->post([this, op] { start(op); });
+}
+
+std::future<AsyncResult> AsyncExecutor::execute(std::shared_ptr<Connection> conn, std::string sql) {
+    auto promise = std::make_shared<std::promise<AsyncResult>>();
+    std::future<AsyncResult> future = promise->get_future();
+    execute(std::move(conn), std::move(sql), [promise](AsyncResult res) {
+        promise->set_value(std::move(res));
+    });
+    return future;
+}
+
+void AsyncExecutor::start(const OperationPtr &op) {
+    MYSQL *mysql = op->conn->handle();
+    op->fd = mysql_get_socket(mysql);
+    op->started = true;
+    advance(op, mysql_real_query_start(&op->err, mysql, op->sql.data(), op->sql.size()));
+}
+
+void AsyncExecutor::resume(const OperationPtr &op, int ready) {
+    MYSQL *mysql = op->conn->handle();
+    if (op->phase == Operation::QUERY) {
+        advance(op, mysql_real_query_cont(&op->err, mysql, ready));
+    } else {
+        advance(op, mysql_store_result_cont(&op->res, mysql, ready));
+    }
+}
+
+void AsyncExecutor::advance(const OperationPtr &op, int status) {
+    if (status != 0) {
+        wait(op, status);
+        return;
+    }
+    if (op->phase == Operation::QUERY) {
+        if (op->err) {
+            finish(op, false);
+            return;
+        }
+        // 语句执行完了，接着把结果集读到客户端，没有结果集的语句会立即完成
+        op->phase = Operation::STORE;
+        advance(op, mysql_store_result_start(&op->res, op->conn->handle()));
+        return;
+    }
+    finish(op, op->res != nullptr || mysql_field_count(op->conn->handle()) == 0);
+}
+
+void AsyncExecutor::wait(const OperationPtr &op, int status) {
+    EventLoop *loop = op->loop;
+    if (op->timer) {
+        loop->cancel(op->timer);
+        op->timer = 0;
+    }
+
+    uint32_t events = 0;
+    if (status & MYSQL_WAIT_READ) {
+        events |= EPOLLIN;
+    }
+    if (status & MYSQL_WAIT_WRITE) {
+        events |= EPOLLOUT;
+    }
+    if (status & MYSQL_WAIT_EXCEPT) {
+        events |= EPOLLPRI;
+    }
+    bool watched = loop->watch(op->fd, events, [this, op](uint32_t revents) {
+        int ready = 0;
+        if (revents & EPOLLIN) {
+            ready |= MYSQL_WAIT_READ;
+        }
+        if (revents & EPOLLOUT) {
+            ready |= MYSQL_WAIT_WRITE;
+        }
+        if (revents & EPOLLPRI) {
+            ready |= MYSQL_WAIT_EXCEPT;
+        }
+        // 出错时让客户端库自己去读写，由它报告错误
+        if (revents & (EPOLLERR | EPOLLHUP)) {
+            ready |= MYSQL_WAIT_READ | MYSQL_WAIT_WRITE;
+        }
+        resume(op, ready);
+    });
+    if (!watched) {
+        // socket已经失效，当作失败结束
+        finish(op, false);
+        return;
+    }
+
+    if (status & MYSQL_WAIT_TIMEOUT) {
+        unsigned int ms = mysql_get_timeout_value_ms(op->conn->handle());
+        op->timer = loop->runAfter(std::chrono::milliseconds(ms), [this, op] {
+            op->timer = 0;
+            resume(op, MYSQL_WAIT_TIMEOUT);
+        });
+    }
+}
+
+void AsyncExecutor::finish(const OperationPtr &op, bool ok) {
+    op->loop->unwatch(op->fd);
+    if (op->timer) {
+        op->loop->cancel(op->timer);
+        op->timer = 0;
+    }
+
+    op->done = true;
+    MYSQL *mysql = op->conn->handle();
+    AsyncResult res;
+    res.ok = ok;
+    // 连接在回调返回后就还回池子，结果集已经全部读到客户端，不需要再访问连接，不能把句柄交出去
+    res.result = ResultSet(op->res, nullptr);
+    op->res = nullptr;
+    if (ok) {
+        res.affectedRows = mysql_affected_rows(mysql);
+        res.insertId = mysql_insert_id(mysql);
+    } else {
+        res.errNo = mysql_errno(mysql);
+        res.error = mysql_error(mysql);
+    }
+
+    // 操作已经结束，回调中可以马上在同一个连接上发起下一个操作。
+    // 回调抛出的异常在这里吞掉，否则会一直传到事件循环线程外面导致进程退出，
+    // 同一个线程上其他连接的操作也跟着丢掉
+    Callback callback = std::move(op->callback);
+    try {
+        callback(std::move(res));
+    } catch (const std::exception &e) {
+        std::cout << "异步回调抛出异常:" << e.what() << std::endl;
+    } catch (...) {
+        std::cout << "异步回调抛出未知异常" << std::endl;
+    }
+    op->conn.reset();
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Connection.h"
+#include "EventLoop.h"
+#include "ResultSet.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace yoko
+{
+
+/**
+ * 异步执行的结果
+ */
+struct AsyncResult {
+    bool ok = false;
+    unsigned int errNo = 0;
+    std::string error;
+    ResultSet result;   // 有结果集的语句（SELECT等），已经全部读到客户端
+    uint64_t affectedRows = 0;
+    uint64_t insertId = 0;
+};
+
+/**
+ * 用MariaDB客户端的非阻塞接口（mysql_real_query_start/_cont）异步执行sql，
+ * 由几个epoll事件循环线程驱动，一个线程就能同时让几百个连接上的查询在跑，不用每个查询占一个线程。
+ *
+ * 用法：
+ *     AsyncExecutor executor(2);
+ *     auto conn = ConnectionPool::instance()->getConnection();
+ *     executor.execute(conn, "select ...", [](AsyncResult res) { ... });
+ *     std::future<AsyncResult> f = executor.execute(conn2, "update ...");
+ *
+ * 操作完成之前executor持有conn，回调返回后才释放，所以连接这时才会还回连接池。
+ * 同一个连接上同时只能有一个操作。需要链接MariaDB的客户端库，连接必须由Connection::connect建立
+ */
+class AsyncExecutor {
+public:
+    // 回调在事件循环线程中执行，不能阻塞；回调抛出的异常会被捕获并打印，不会传出事件循环
+    using Callback = std::function<void(AsyncResult)>;
+
+    explicit AsyncExecutor(int threads = 1);
+    // 未完成的操作直接丢弃，回调不会被调用，future会得到broken_promise。
+    // 已经开始执行的操作所用的连接会被标记为损坏，还回连接池时关闭
+    ~AsyncExecutor();
+
+    AsyncExecutor(const AsyncExecutor &) = delete;
+    AsyncExecutor &operator=(const AsyncExecutor &) = delete;
+
+    void execute(std::shared_ptr<Connection> conn, std::string sql, Callback callback);
+    std::future<AsyncResult> execute(std::shared_ptr<Connection> conn, std::string sql);
+
+private:
+    struct Operation;
+    using OperationPtr = std::shared_ptr<Operation>;
+
+    // 以下都在op所属的事件循环线程中执行
+    void start(const OperationPtr &op);
+    // 用_cont继续当前阶段，ready是MYSQL_WAIT_*
+    void resume(const OperationPtr &op, int ready);
+    // status是_start/_cont的返回值，0表示当前阶段完成
+    void advance(const OperationPtr &op, int status);
+    // 按status监视socket或者设置超时
+    void wait(const OperationPtr &op, int status);
+    void finish(const OperationPtr &op, bool ok);
+
+    std::vector<std::unique_ptr<EventLoop>> loops_;
+    std::vector<std::thread> threads_;
+    std::atomic<size_t> next_;
+};
+
+} // namespace yoko
@@ -0,0 +1,94 @@
+#include "Batch.h"
+
+using namespace yoko;
+
+// 去掉末尾的空白和分号，拼接时统一用';'分隔
+static std::string_view trimStatement(std::string_view sql) {
+    while (!sql.empty() && (sql.back() == ';' || sql.back() == ' ' || sql.back() == '\t'
+            || sql.back() == '\r' || sql.back() == '\n')) {
+        sql.remove_suffix(1);
+    }
+    return sql;
+}
+
+bool Batch::single(std::string_view sql) {
+    sql = trimStatement(sql);
+    char quote = 0;     // 当前所在的引号
+    for (size_t i = 0; i < sql.size(); ++i) {
+        char c = sql[i];
+        if (quote != 0) {
+            // 连续两个引号表示引号本身，相当于先结束再开始
+            if (c == '\\' && quote != '`') {
+                ++i;
+            } else if (c == quote) {
+                quote = 0;
+            }
+            continue;
+        }
+        if (c == '\'' || c == '"' || c == '`') {
+            quote = c;
+        } else if (c == '#' || (c == '-' && i + 2 < sql.size() && sql[i + 1] == '-'
+                && (sql[i + 2] == ' ' || sql[i + 2] == '\t' || sql[i + 2] == '\n' || sql[i + 2] == '\r'))) {
+            // 单行注释，以它结尾时拼接的';'也会被注释掉
+            size_t end = sql.find('\n', i);
+            if (end == std::string_view::npos) {
+                return false;
+            }
+            i = end;
+        } else if (c == '/' && i + 1 < sql.size() && sql[i + 1] == '*') {
+            size_t end = sql.find("*/", i + 2);
+            if (end == std::string_view::npos) {
+                return false;
+            }
+            i = end + 1;
+        } else if (c == ';') {
+            return false;
+        }
+    }
+    return quote == 0;
+}
+
+void Batch::separate() {
+    if (!sql_.empty()) {
+        sql_ += ';';
+    }
+}
+
+bool Batch::add(std::string_view sql) {
+    if (!single(sql)) {
+        return false;
+    }
+    separate();
+    sql_.append(trimStatement(sql));
+    groups_.push_back(1);
+    ++size_;
+    lastPrefix_.clear();
+    return true;
+}
+
+bool Batch::addInsert(std::string_view prefix, std::string_view row) {
+    if (!single(prefix) || !single(row)) {
+        return false;
+    }
+    if (!lastPrefix_.empty() && prefix == lastPrefix_) {
+        sql_ += ',';
+        sql_.append(row);
+        ++groups_.back();
+    } else {
+        separate();
+        sql_.append(prefix);
+        sql_ += " VALUES ";
+        sql_.append(row);
+        groups_.push_back(1);
+        lastPrefix_.assign(prefix.data(), prefix.size());
+    }
+    ++size_;
+    return true;
+}
+
+void Batch::clear() {
+    sql_.clear();
+    groups_.clear();
+    size_ = 0;
+    lastPrefix_.clear();
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace yoko
+{
+
+/**
+ * 一条语句的执行结果
+ */
+struct StatementResult {
+    bool ok = false;
+    unsigned int errNo = 0;
+    std::string error;
+    uint64_t affectedRows = 0;
+    uint64_t insertId = 0;
+    // 不知道有没有执行：语句已经发给服务端，但是结果对不上。ok为false，但不能当作失败重试
+    bool indeterminate = false;
+};
+
+/**
+ * 攒一批写语句，由Connection::execute用多语句模式拼成一条sql发出去。
+ * 连接一直打开着多语句模式时（BatchWriter就是这样）整批只有一次网络往返，
+ * 否则前后还要各一次往返打开、关闭多语句模式。
+ * 连续的、表和列都相同的addInsert()合并成一条多行INSERT：
+ *     batch.addInsert("INSERT INTO t(a, b)", "(1, 'x')");
+ *     batch.addInsert("INSERT INTO t(a, b)", "(2, 'y')");    // 合并成 INSERT INTO t(a, b) VALUES (1, 'x'),(2, 'y')
+ * 合并后的每一行都得到整条INSERT的结果。
+ * 只适合写语句，SELECT的结果集会被丢弃。
+ * 语句拼接在一起发送，一条语句里有引号和注释之外的';'时会被服务端拆成多条，结果就对不上了，
+ * 所以这样的语句不会加入，add()返回false；末尾的';'会去掉，不算在内
+ */
+class Batch {
+public:
+    bool add(std::string_view sql);
+    // prefix是"INSERT INTO 表(列...)"，row是带括号的一行值
+    bool addInsert(std::string_view prefix, std::string_view row);
+    // sql拼接之后是否还是一条语句：引号和注释之外没有';'，引号都配对，不以单行注释结尾
+    static bool single(std::string_view sql);
+
+    // 加入的语句数（合并的INSERT按行数算），execute的结果和它一一对应
+    size_t size() const { return size_; }
+    // 实际发送的语句数
+    size_t queries() const { return groups_.size(); }
+    // 拼接后的sql长度，注意不要超过服务端的max_allowed_packet
+    size_t bytes() const { return sql_.size(); }
+    bool empty() const { return size_ == 0; }
+    void clear();
+
+    const std::string &sql() const { return sql_; }
+    // 第i条实际发送的语句包含几条加入的语句
+    const std::vector<size_t> &groups() const { return groups_; }
+
+private:
+    void separate();
+
+    std::string sql_;
+    std::vector<size_t> groups_;
+    size_t size_ = 0;
+    std::string lastPrefix_;    // 上一条是addInsert时为它的prefix，否则为空
+};
+
+} // namespace yoko
@@ -0,0 +1,173 @@
+#include "BatchWriter.h"
+#include "ConnectionPool.h"
+
+using namespace yoko;
+
+BatchWriter::BatchWriter(ConnectionPool *pool, size_t maxStatements, size_t maxBytes,
+                std::chrono::milliseconds maxDelay)
+    : pool_(pool)
+    , maxStatements_(maxStatements)
+    , maxBytes_(maxBytes)
+    , maxDelay_(maxDelay)
+    , thread_(&BatchWriter::run, this) {}
+
+BatchWriter::~BatchWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        stop_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+}
+
+// 不能放进批次的语句直接返回失败，不影响同一批的其他语句
+static std::future<StatementResult> rejected() {
+    std::promise<StatementResult> promise;
+    StatementResult r;
+    r.error = "statement contains ';' outside quotes";
+    promise.set_value(r);
+    return promise.get_future();
+}
+
+std::future<StatementResult> BatchWriter::add(std::string_view sql) {
+    if (!Batch::single(sql)) {
+        return rejected();
+    }
+    std::unique_lock<std::mutex> lock(mtx_);
+    reserve(sql.size() + 1);
+    batch_.add(sql);
+    return added(lock);
+}
+
+std::future<StatementResult> BatchWriter::addInsert(std::string_view prefix, std::string_view row) {
+    if (!Batch::single(prefix) || !Batch::single(row)) {
+        return rejected();
+    }
+    std::unique_lock<std::mutex> lock(mtx_);
+    // 按不能合并算，最多多算了prefix的长度
+    reserve(prefix.size() + row.size() + 9);
+    batch_.addInsert(prefix, row);
+    return added(lock);
+}
+
+std::future<StatementResult> BatchWriter::added(std::unique_lock<std::mutex> &lock) {
+    promises_.emplace_back();
+    std::future<StatementResult> future = promises_.back().get_future();
+    bool notify = false;
+    if (batch_.size() == 1) {
+        // 第一条语句决定这一批最晚什么时候执行
+        deadline_ = Clock::now() + maxDelay_;
+        notify = true;
+    }
+    if (batch_.size() >= maxStatements_ || batch_.bytes() >= maxBytes_) {
+        seal();
+        notify = true;
+    }
+    lock.unlock();
+    if (notify) {
+        cv_.notify_one();
+    }
+    return future;
+}
+
+// 加上bytes会超过maxBytes时先把当前这一批封起来，新语句放进下一批。
+// 单条语句本身超过maxBytes时只能自己一批
+void BatchWriter::reserve(size_t bytes) {
+    if (!batch_.empty() && batch_.bytes() + bytes > maxBytes_) {
+        seal();
+        cv_.notify_one();
+    }
+}
+
+// 执行线程还在执行上一批时，封好的批次排队，不再往里加，每次往返都不超过上限
+void BatchWriter::seal() {
+    sealed_.emplace_back();
+    std::swap(sealed_.back().batch, batch_);
+    std::swap(sealed_.back().promises, promises_);
+}
+
+void BatchWriter::flush() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        flushNow_ = true;
+    }
+    cv_.notify_one();
+}
+
+void BatchWriter::run() {
+    Batch batch;
+    std::vector<std::promise<StatementResult>> promises;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            while (!stop_ && sealed_.empty() && (batch_.empty() || (!flushNow_ && Clock::now() < deadline_))) {
+                if (batch_.empty()) {
+                    // 没有语句了，连接还回去，不要一直占着；还连接要一次往返，不持有锁
+                    if (conn_) {
+                        lock.unlock();
+                        release();
+                        lock.lock();
+                        continue;
+                    }
+                    cv_.wait(lock);
+                } else {
+                    cv_.wait_until(lock, deadline_);
+                }
+            }
+            // 交换出来在锁外执行，执行期间其他线程可以继续往新的一批中加
+            if (!sealed_.empty()) {
+                std::swap(batch, sealed_.front().batch);
+                std::swap(promises, sealed_.front().promises);
+                sealed_.pop_front();
+            } else if (!batch_.empty()) {
+                std::swap(batch, batch_);
+                std::swap(promises, promises_);
+                flushNow_ = false;
+            } else {
+                // stop_为true，而且已经没有语句了
+                lock.unlock();
+                release();
+                return;
+            }
+        }
+        execute(batch, promises);
+        batch.clear();
+        promises.clear();
+    }
+}
+
+void BatchWriter::execute(Batch &batch, std::vector<std::promise<StatementResult>> &promises) {
+    if (!conn_) {
+        conn_ = pool_->getConnection();
+        if (!conn_) {
+            StatementResult r;
+            r.error = "get connection timeout";
+            for (auto &p : promises) {
+                p.set_value(r);
+            }
+            return;
+        }
+        // 打开失败时execute()每一批自己打开、关闭，只是多两次往返
+        conn_->setMultiStatements(true);
+    }
+
+    std::vector<StatementResult> results = conn_->execute(batch);
+    // 2000以上是客户端的错误（连接断开等），换一个连接
+    for (const StatementResult &r : results) {
+        if (r.errNo >= 2000) {
+            conn_->setBroken();
+            conn_.reset();
+            break;
+        }
+    }
+    for (size_t i = 0; i < promises.size(); ++i) {
+        promises[i].set_value(std::move(results[i]));
+    }
+}
+
+void BatchWriter::release() {
+    if (conn_) {
+        conn_->setMultiStatements(false);
+        conn_.reset();
+    }
+}
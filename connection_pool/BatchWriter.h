@@ -0,0 +1,86 @@
+#pragma once
+
+#include "Batch.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace yoko
+{
+
+class Connection;
+class ConnectionPool;
+
+/**
+ * 自动攒批的写入器：多个线程add()语句，后台线程在语句数、字节数达到上限，
+ * 或者最早的一条已经等了maxDelay时，从连接池取一个连接整批执行。
+ * add()只是把语句放进缓冲区，不会等待网络，每条语句的结果通过future返回。
+ * maxStatements和maxBytes是每一批的上限，maxBytes要小于服务端的max_allowed_packet。
+ * 有语句要执行时后台线程一直占着连接池的一个连接，并且打开多语句模式，每一批只有一次往返；
+ * 缓冲区空了就关闭多语句模式，把连接还回去。
+ *
+ * 用法：
+ *     BatchWriter writer(ConnectionPool::instance());
+ *     auto f = writer.addInsert("INSERT INTO log(uid, msg)", "(1, 'login')");
+ *     if (!f.get().ok) { ... }
+ */
+class BatchWriter {
+public:
+    BatchWriter(ConnectionPool *pool, size_t maxStatements = 256, size_t maxBytes = 1 << 20,
+                std::chrono::milliseconds maxDelay = std::chrono::milliseconds(5));
+    // 执行完缓冲区中剩下的语句再返回
+    ~BatchWriter();
+
+    BatchWriter(const BatchWriter &) = delete;
+    BatchWriter &operator=(const BatchWriter &) = delete;
+
+    std::future<StatementResult> add(std::string_view sql);
+    std::future<StatementResult> addInsert(std::string_view prefix, std::string_view row);
+    // 让后台线程立即执行缓冲区中的语句，不等待执行完成
+    void flush();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void run();
+    // 加入一条语句之后调用，已经持有mtx_
+    std::future<StatementResult> added(std::unique_lock<std::mutex> &lock);
+    // 以下两个持有mtx_时调用
+    void reserve(size_t bytes);
+    void seal();
+    void execute(Batch &batch, std::vector<std::promise<StatementResult>> &promises);
+    // 关闭多语句模式，把conn_还给连接池
+    void release();
+
+    ConnectionPool *pool_;
+    size_t maxStatements_;
+    size_t maxBytes_;
+    std::chrono::milliseconds maxDelay_;
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    // 已经满了等待执行的一批
+    struct Pending {
+        Batch batch;
+        std::vector<std::promise<StatementResult>> promises;
+    };
+
+    Batch batch_;   // 正在攒的一批
+    std::vector<std::promise<StatementResult>> promises_;
+    std::deque<Pending> sealed_;
+    Clock::time_point deadline_;    // 缓冲区中最早一条语句的执行期限
+    bool flushNow_ = false;
+    bool stop_ = false;
+    std::shared_ptr<Connection> conn_;  // 只在后台线程中使用
+    std::thread thread_;
+};
+
+} // namespace yoko
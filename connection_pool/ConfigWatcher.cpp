@@ -0,0 +1,115 @@
+#include "ConfigWatcher.h"
+
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+using namespace yoko;
+
+// 收到事件后再等这么久没有新事件才调用回调
+static const int kSettleMs = 50;
+
+ConfigWatcher::ConfigWatcher(const std::string &filename, Callback callback)
+    : callback_(std::move(callback))
+    , inotifyFd_(-1)
+    , stopFd_(-1) {
+    size_t idx = filename.rfind('/');
+    if (idx == std::string::npos) {
+        dir_ = ".";
+        name_ = filename;
+    } else {
+        dir_ = idx == 0 ? "/" : filename.substr(0, idx);
+        name_ = filename.substr(idx + 1);
+    }
+}
+
+ConfigWatcher::~ConfigWatcher() {
+    stop();
+}
+
+bool ConfigWatcher::start() {
+    if (thread_.joinable()) {
+        return true;
+    }
+    inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd_ < 0) {
+        return false;
+    }
+    if (inotify_add_watch(inotifyFd_, dir_.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE) < 0) {
+        close(inotifyFd_);
+        inotifyFd_ = -1;
+        return false;
+    }
+    stopFd_ = eventfd(0, EFD_CLOEXEC);
+    if (stopFd_ < 0) {
+        close(inotifyFd_);
+        inotifyFd_ = -1;
+        return false;
+    }
+    thread_ = std::thread(&ConfigWatcher::run, this);
+    return true;
+}
+
+void ConfigWatcher::stop() {
+    if (thread_.joinable()) {
+        uint64_t one = 1;
+        ssize_t n = write(stopFd_, &one, sizeof(one));
+        (void)n;
+        thread_.join();
+    }
+    if (inotifyFd_ >= 0) {
+        close(inotifyFd_);
+        inotifyFd_ = -1;
+    }
+    if (stopFd_ >= 0) {
+        close(stopFd_);
+        stopFd_ = -1;
+    }
+}
+
+void ConfigWatcher::run() {
+    bool pending = false;
+    while (true) {
+        pollfd fds[2] = {{inotifyFd_, POLLIN, 0}, {stopFd_, POLLIN, 0}};
+        int ret = poll(fds, 2, pending ? kSettleMs : -1);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        if (fds[1].revents) {
+            return;
+        }
+        if (ret == 0) {
+            // 一段时间内没有新的修改，文件应该已经写完了
+            pending = false;
+            callback_();
+            continue;
+        }
+        if (drain()) {
+            pending = true;
+        }
+    }
+}
+
+bool ConfigWatcher::drain() {
+    alignas(inotify_event) char buf[4096];
+    bool matched = false;
+    while (true) {
+        ssize_t n = read(inotifyFd_, buf, sizeof(buf));
+        if (n <= 0) {
+            return matched;
+        }
+        for (char *p = buf; p < buf + n;) {
+            inotify_event *ev = reinterpret_cast<inotify_event *>(p);
+            if (ev->len > 0 && name_ == ev->name) {
+                matched = true;
+            }
+            p += sizeof(inotify_event) + ev->len;
+        }
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace yoko
+{
+
+/**
+ * 用inotify监视配置文件，文件被改写、替换（编辑器常用先写临时文件再rename的方式）时调用回调。
+ * 监视的是文件所在的目录，所以文件被删除后重新创建也能收到。
+ * 短时间内的多次修改合并成一次回调，回调在后台线程中执行
+ */
+class ConfigWatcher {
+public:
+    using Callback = std::function<void()>;
+
+    ConfigWatcher(const std::string &filename, Callback callback);
+    ~ConfigWatcher();
+
+    ConfigWatcher(const ConfigWatcher &) = delete;
+    ConfigWatcher &operator=(const ConfigWatcher &) = delete;
+
+    // 开始监视，inotify不可用或者目录不存在时返回false
+    bool start();
+    void stop();
+
+private:
+    void run();
+    // 读出所有待处理的事件，有和文件相关的事件时返回true
+    bool drain();
+
+    std::string dir_;
+    std::string name_;
+    Callback callback_;
+    int inotifyFd_;
+    int stopFd_;    // eventfd，写入后线程退出
+    std::thread thread_;
+};
+
+} // namespace yoko
@@ -1,6 +1,8 @@
 #include "Connection.h"
 
 #include <iostream>
+#include <cerrno>
+#include <poll.h>
 
 using namespace yoko;
 
@@ -11,6 +13,8 @@ Connection::Connection() {
 
 // 释放数据库连接资源
 Connection::~Connection() {
+    // 预处理语句要在连接关闭之前关闭
+    statements_.clear();
     if (conn_ != nullptr) {
         mysql_close(conn_);
     }
@@ -19,14 +23,112 @@ Connection::~Connection() {
 // 连接数据库
 bool Connection::connect(std::string ip, uint16_t port, std::string user,
             std::string passwd, std::string db) {
+    // 打开非阻塞模式，阻塞的接口照样可以用，AsyncExecutor需要它（MariaDB客户端库）
+    mysql_options(conn_, MYSQL_OPT_NONBLOCK, 0);
     MYSQL *p = mysql_real_connect(conn_, ip.c_str(), user.c_str(), passwd.c_str(),
                     db.c_str(), port, nullptr, 0);
-    return p != nullptr;
+    if (p == nullptr) {
+        return false;
+    }
+    createTime_ = idleSince_ = Clock::now();
+    return true;
+}
+
+// 保活
+bool Connection::ping() {
+    if (mysql_ping(conn_)) {
+        return false;
+    }
+    lastPing_ = Clock::now();
+    return true;
+}
+
+// 批量保活，所有连接的请求先发出去，再用poll等它们的回复
+std::vector<bool> Connection::ping(const std::vector<Connection *> &conns, std::chrono::milliseconds timeout) {
+    std::vector<bool> ok(conns.size(), false);
+    std::vector<int> status(conns.size(), 0);
+    std::vector<size_t> pending;    // 还没完成的连接
+    for (size_t i = 0; i < conns.size(); ++i) {
+        int err = 0;
+        status[i] = mysql_ping_start(&err, conns[i]->conn_);
+        if (status[i] != 0) {
+            pending.push_back(i);
+        } else if (err == 0) {
+            ok[i] = true;
+        }
+    }
+
+    Clock::time_point deadline = Clock::now() + timeout;
+    std::vector<pollfd> fds;
+    std::vector<size_t> next;
+    while (!pending.empty()) {
+        auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - Clock::now());
+        if (left.count() <= 0) {
+            break;
+        }
+        fds.clear();
+        for (size_t i : pending) {
+            short events = 0;
+            if (status[i] & MYSQL_WAIT_READ) {
+                events |= POLLIN;
+            }
+            if (status[i] & MYSQL_WAIT_WRITE) {
+                events |= POLLOUT;
+            }
+            if (status[i] & MYSQL_WAIT_EXCEPT) {
+                events |= POLLPRI;
+            }
+            fds.push_back(pollfd{mysql_get_socket(conns[i]->conn_), events, 0});
+        }
+        if (poll(fds.data(), fds.size(), static_cast<int>(left.count())) < 0 && errno != EINTR) {
+            break;
+        }
+
+        next.clear();
+        for (size_t k = 0; k < pending.size(); ++k) {
+            size_t i = pending[k];
+            short revents = fds[k].revents;
+            int ready = 0;
+            if (revents & POLLIN) {
+                ready |= MYSQL_WAIT_READ;
+            }
+            if (revents & POLLOUT) {
+                ready |= MYSQL_WAIT_WRITE;
+            }
+            if (revents & POLLPRI) {
+                ready |= MYSQL_WAIT_EXCEPT;
+            }
+            // 出错时让客户端库自己去读写，由它报告错误
+            if (revents & (POLLERR | POLLHUP | POLLNVAL)) {
+                ready |= MYSQL_WAIT_READ | MYSQL_WAIT_WRITE;
+            }
+            if (ready == 0) {
+                next.push_back(i);
+                continue;
+            }
+            int err = 0;
+            status[i] = mysql_ping_cont(&err, conns[i]->conn_, ready);
+            if (status[i] != 0) {
+                next.push_back(i);
+            } else if (err == 0) {
+                ok[i] = true;
+            }
+        }
+        pending.swap(next);
+    }
+
+    Clock::time_point now = Clock::now();
+    for (size_t i = 0; i < conns.size(); ++i) {
+        if (ok[i]) {
+            conns[i]->lastPing_ = now;
+        }
+    }
+    return ok;
 }
 
 // 增删改
-bool Connection::update(std::string sql) {
-    if (mysql_query(conn_, sql.c_str())) {
+bool Connection::update(const std::string &sql) {
+    if (mysql_real_query(conn_, sql.data(), sql.size())) {
         std::cout << "查询失败:" << sql << std::endl;
         return false;
     }
@@ -34,10 +136,161 @@ bool Connection::update(std::string sql) {
 }
 
 // 查询
-MYSQL_RES *Connection::query(std::string sql) {
-    if (mysql_query(conn_, sql.c_str())) {
+MYSQL_RES *Connection::query(const std::string &sql) {
+    if (mysql_real_query(conn_, sql.data(), sql.size())) {
         std::cout << "查询失败:" << sql << std::endl;
         return nullptr;
     }
     return mysql_use_result(conn_);
-}
\ No newline at end of file
+}
+
+// 查询，结果由ResultSet释放
+ResultSet Connection::select(const std::string &sql, ResultSet::Mode mode) {
+    if (mysql_real_query(conn_, sql.data(), sql.size())) {
+        std::cout << "查询失败:" << sql << std::endl;
+        return ResultSet();
+    }
+    if (mode == ResultSet::BUFFERED) {
+        return ResultSet(mysql_store_result(conn_), conn_);
+    }
+    // 没读完之前连接不能给别人用，由shared_ptr管理的连接让结果集持有它
+    return ResultSet(mysql_use_result(conn_), conn_, weak_from_this().lock());
+}
+
+// 批量执行
+std::vector<StatementResult> Connection::execute(const Batch &batch) {
+    std::vector<StatementResult> results(batch.size());
+    const std::vector<size_t> &groups = batch.groups();
+    size_t g = 0;   // 当前是第几条实际发送的语句
+    size_t idx = 0; // 它对应的第一个结果
+    bool mismatch = false;  // 结果比发送的语句多
+
+    // 合并后的一条语句的结果复制给它包含的每条语句
+    auto fill = [&](bool ok) {
+        // 单条语句被服务端拆成了多条时结果会比预期的多，不知道哪些结果对应哪条语句
+        if (g == groups.size()) {
+            mismatch = true;
+            return;
+        }
+        StatementResult r;
+        r.ok = ok;
+        if (ok) {
+            r.affectedRows = mysql_affected_rows(conn_);
+            r.insertId = mysql_insert_id(conn_);
+        } else {
+            r.errNo = mysql_errno(conn_);
+            r.error = mysql_error(conn_);
+        }
+        for (size_t i = 0; i < groups[g]; ++i) {
+            results[idx + i] = r;
+        }
+        idx += groups[g];
+        ++g;
+    };
+
+    // 没有一直打开多语句模式时只在这一批中打开，连接还回池子后别人的update/query不能执行拼接出来的多条语句
+    bool multi = groups.size() > 1 && !multiStatements_;
+    if (multi && mysql_set_server_option(conn_, MYSQL_OPTION_MULTI_STATEMENTS_ON)) {
+        std::cout << "打开多语句模式失败:" << mysql_error(conn_) << std::endl;
+        for (StatementResult &r : results) {
+            r.error = "not executed";
+        }
+        return results;
+    }
+
+    if (!batch.empty()) {
+        if (mysql_real_query(conn_, batch.sql().data(), batch.sql().size())) {
+            fill(false);
+        } else {
+            while (true) {
+                // 每条语句的结果都要取出来，否则连接处于不同步的状态
+                MYSQL_RES *res = mysql_store_result(conn_);
+                if (res != nullptr) {
+                    mysql_free_result(res);
+                }
+                fill(true);
+                int status = mysql_next_result(conn_);
+                if (status < 0) {
+                    break;
+                }
+                if (status > 0) {
+                    fill(false);
+                    break;
+                }
+            }
+        }
+    }
+
+    // 所有结果都取完了才能关闭
+    if (multi && mysql_set_server_option(conn_, MYSQL_OPTION_MULTI_STATEMENTS_OFF)) {
+        std::cout << "关闭多语句模式失败:" << mysql_error(conn_) << std::endl;
+        broken_ = true;
+    }
+
+    if (mismatch) {
+        // 服务端已经执行了这些语句，只是结果对不上，按失败处理的话调用者重试时会再执行一遍
+        for (StatementResult &r : results) {
+            r = StatementResult();
+            r.indeterminate = true;
+            r.error = "result count mismatch, outcome unknown";
+        }
+        return results;
+    }
+    for (; idx < results.size(); ++idx) {
+        results[idx].error = "not executed";
+    }
+    return results;
+}
+
+bool Connection::setMultiStatements(bool on) {
+    if (on == multiStatements_) {
+        return true;
+    }
+    if (mysql_set_server_option(conn_, on ? MYSQL_OPTION_MULTI_STATEMENTS_ON : MYSQL_OPTION_MULTI_STATEMENTS_OFF)) {
+        std::cout << "设置多语句模式失败:" << mysql_error(conn_) << std::endl;
+        // 关闭失败的连接不能再还给别人用
+        if (!on) {
+            broken_ = true;
+        }
+        return false;
+    }
+    multiStatements_ = on;
+    return true;
+}
+
+// 预处理语句
+std::shared_ptr<Statement> Connection::prepare(const std::string &sql) {
+    std::shared_ptr<Statement> stmt = statements_.get(sql);
+    if (stmt) {
+        return pin(std::move(stmt));
+    }
+
+    MYSQL_STMT *handle = mysql_stmt_init(conn_);
+    if (handle == nullptr) {
+        return nullptr;
+    }
+    if (mysql_stmt_prepare(handle, sql.data(), sql.size())) {
+        std::cout << "预处理失败:" << sql << " " << mysql_stmt_error(handle) << std::endl;
+        mysql_stmt_close(handle);
+        return nullptr;
+    }
+    stmt = std::make_shared<Statement>(handle, sql);
+    statements_.put(stmt);
+    return pin(std::move(stmt));
+}
+
+// 缓存中的Statement不持有连接，否则连接和缓存互相引用。
+// 从连接池借出的连接由shared_ptr管理，给用户的指针同时持有它
+std::shared_ptr<Statement> Connection::pin(std::shared_ptr<Statement> stmt) {
+    std::shared_ptr<Connection> self = weak_from_this().lock();
+    if (!self) {
+        return stmt;
+    }
+    auto holder = std::make_shared<std::pair<std::shared_ptr<Connection>, std::shared_ptr<Statement>>>(
+        std::move(self), std::move(stmt));
+    return std::shared_ptr<Statement>(holder, holder->second.get());
+}
+
+void Connection::recycle() {
+    statements_.freeResults();
+}
@@ -1,31 +1,86 @@
 #pragma once
 
+#include "Batch.h"
+#include "ResultSet.h"
+#include "Statement.h"
+
 #include <mysql/mysql.h>
 #include <string>
-#include <ctime>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <utility>
+#include <vector>
 
 namespace yoko
 {
 
 /**
  * 封装mysql操作的类
- * 查询结果得到的MYSQL_RES的需要用户释放，不好用
+ * query得到的MYSQL_RES需要用户释放，新代码用select，结果由ResultSet管理
  */
-class Connection {
+class Connection : public std::enable_shared_from_this<Connection> {
 public:
+    using Clock = std::chrono::steady_clock;
+
     Connection();
     ~Connection();
 
     bool connect(std::string ip, uint16_t port, std::string user,
                 std::string passwd, std::string db);
-    bool update(std::string sql);
-    MYSQL_RES *query(std::string sql);
+    bool update(const std::string &sql);
+    MYSQL_RES *query(const std::string &sql);
+    // 执行查询，出错时返回空的ResultSet，用mysql_errno(handle())查看原因。
+    // STREAM模式的结果集在释放之前占着连接（连接由shared_ptr管理时）
+    ResultSet select(const std::string &sql, ResultSet::Mode mode = ResultSet::STREAM);
+    // 整批语句拼成一条sql发送，结果和batch中的语句一一对应。
+    // 某条语句出错后服务端不再执行后面的语句，它们的结果为"not executed"。
+    // 实际发送的语句多于一条时要用多语句模式：没有用setMultiStatements()一直打开的话，
+    // 执行前后各多一次往返来打开、关闭它，一共三次往返。
+    // 万一结果和语句对不上，整批都标记为indeterminate而不是失败
+    std::vector<StatementResult> execute(const Batch &batch);
+    // 一直打开多语句模式，之后execute()只要一次往返。打开期间update/query中的';'也会分隔语句，
+    // 只用于专门执行Batch的连接，还回连接池之前要关闭；关闭失败时连接标记为broken
+    bool setMultiStatements(bool on);
+    // 取sql对应的预处理语句，缓存中没有时在服务端准备好再放进缓存，失败时返回nullptr。
+    // 缓存跟着连接走，连接还回连接池再取出来时仍然有效。
+    // 连接由shared_ptr管理时（从连接池借出的都是），返回的指针同时持有连接：
+    // 用户拿着Statement时连接不会还回去，也就不会和下一个借到这个连接的人共用MYSQL_STMT
+    std::shared_ptr<Statement> prepare(const std::string &sql);
+    // 还回连接池时调用：丢弃缓存的预处理语句没有读完的结果集，下一个人拿到的连接是同步的状态
+    void recycle();
+    // 重连之后旧的预处理语句都失效了，需要清空
+    void clearStatements() { statements_.clear(); }
+
+    // 底层的句柄，AsyncExecutor等扩展用
+    MYSQL *handle() const { return conn_; }
+    // 连接处于不同步的状态（比如非阻塞操作做到一半被放弃），不能再用，连接池会关闭它
+    void setBroken() { broken_ = true; }
+    bool broken() const { return broken_; }
 
-    void refreshTime() { startTime_ = clock(); }
-    clock_t getAliveTime() const { return clock() - startTime_; }
+    // 检查连接是否还活着，失败时连接已经不能用了
+    bool ping();
+    // 用非阻塞接口同时ping一批连接，用时约等于最慢的一次往返，而不是所有往返之和。
+    // 返回每个连接是否可用，timeout内没有完成的算失败，这些连接只能关闭（MariaDB客户端库）
+    static std::vector<bool> ping(const std::vector<Connection *> &conns, std::chrono::milliseconds timeout);
+
+    // 时间都用steady_clock，clock()是进程的CPU时间，进程空闲时几乎不走
+    void refreshTime() { idleSince_ = Clock::now(); }
+    Clock::time_point getIdleSince() const { return idleSince_; }
+    Clock::duration getIdleTime() const { return Clock::now() - idleSince_; }
+    Clock::time_point getCreateTime() const { return createTime_; }
+    // 最后一次确认连接可用的时间：开始空闲或者ping成功，取较晚的
+    Clock::time_point getLastActive() const { return std::max(idleSince_, lastPing_); }
 private:
+    std::shared_ptr<Statement> pin(std::shared_ptr<Statement> stmt);
+
     MYSQL *conn_;
-    clock_t startTime_; // 开始空闲的时间
+    Clock::time_point idleSince_;   // 开始空闲的时间
+    Clock::time_point createTime_;  // 连接建立的时间
+    Clock::time_point lastPing_;    // 最后一次ping成功的时间
+    bool broken_ = false;
+    bool multiStatements_ = false;
+    StatementCache statements_;
 };
 
 } // namespace yoko
\ No newline at end of file
@@ -2,134 +2,474 @@
 
 #include <thread>
 #include <functional>
+#include <vector>
+#include <algorithm>
 
 using namespace yoko;
 
+using Clock = Connection::Clock;
+
+// 批量保活等回复的最长时间
+static const std::chrono::milliseconds kPingTimeout(1000);
+
+// 空闲栈中的时间存成steady_clock的纳秒数
+static int64_t toNanos(Clock::time_point t) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+}
+
+static Clock::time_point fromNanos(int64_t ns) {
+    return Clock::time_point(std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(ns)));
+}
+
 ConnectionPool *ConnectionPool::instance() {
     static ConnectionPool pool;
     return &pool;
 }
 
-// 可以用自己写的xml解析器读配置文件
-bool ConnectionPool::loadConfig() {
-    FILE *fp = fopen("mysql.conf", "r");
-    if (fp == nullptr) {
-        LOG("mysql.conf file is not exist!");
-    }
-
-    while (!feof(fp)) {
-        char buf[1024] = {0};
-        fgets(buf, 1024, fp);
-        std::string line(buf);
-        size_t idx = line.find('=', 0);
-        if (idx == std::string::npos) {
-            return false;
-        }
-
-        size_t end = line.find('\n', idx);  // TODO:这里有问题，最后一行不一定包括'\n'
-        std::string key = line.substr(0, idx);
-        std::string value = line.substr(idx + 1, end - idx - 1);
-
-        if (key == "ip") {
-			ip_ = value;
-		} else if (key == "port") {
-			port_ = atoi(value.c_str());
-		} else if (key == "username") {
-			username_ = value;
-		} else if (key == "password") {
-			password_ = value;
-		} else if (key == "db") {
-			dbname_ = value;
-		} else if (key == "initSize") {
-			initSize_ = atoi(value.c_str());
-		} else if (key == "maxSize") {
-			maxSize_ = atoi(value.c_str());
-		} else if (key == "maxIdleTime") {
-			maxIdleTime_ = atoi(value.c_str());
-		} else if (key == "connectionTimeOut") {
-			connectionTimeout_ = atoi(value.c_str());
-		}
-    }
-    return true;
-}
+static const char *kConfigFile = "mysql.conf";
 
+// 支持key=value和xml两种格式
 ConnectionPool::ConnectionPool() {
     // 读配置文件
-    if (!loadConfig()) {
+    PoolConfig config;
+    if (!PoolConfig::load(kConfigFile, config)) {
+        LOG("mysql.conf is not exist or has bad format!");
         return;
     }
+    start(config);
+
+    // 监视配置文件，修改后不用重启
+    watcher_.reset(new ConfigWatcher(kConfigFile, std::bind(&ConnectionPool::reloadConfig, this)));
+    if (!watcher_->start()) {
+        LOG("watch mysql.conf failed, config changes need a restart");
+    }
+}
+
+ConnectionPool::ConnectionPool(const PoolConfig &config) {
+    start(config);
+}
+
+// 借出去的连接必须在这之前都已经还回来
+ConnectionPool::~ConnectionPool() {
+    watcher_.reset();
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        quit_ = true;
+        cv_.notify_all();
+    }
+    if (producer_.joinable()) {
+        producer_.join();
+    }
+    if (maintainer_.joinable()) {
+        maintainer_.join();
+    }
+    while (Connection *conn = idle_.pop()) {
+        delete conn;
+    }
+}
+
+void ConnectionPool::start(const PoolConfig &config) {
+    ip_ = config.ip;
+    port_ = config.port;
+    username_ = config.username;
+    password_ = config.password;
+    dbname_ = config.dbname;
+    initSize_ = config.initSize;
+    maxSize_ = config.maxSize;
+    maxIdleTime_ = config.maxIdleTime;
+    connectionTimeout_ = config.connectionTimeout;
+    keepAliveTime_ = config.keepAliveTime;
+    maxLifeTime_ = config.maxLifeTime;
+    validationTime_ = config.validationTime;
 
     // 初始化连接数
     for (int i = 0; i < initSize_; ++i) {
         Connection *conn = new Connection();
         if (conn->connect(ip_, port_, username_, password_, dbname_)) {
-            connections_.push(conn);
+            pushIdle(conn);
             ++connectionNum_;
+        } else {
+            delete conn;
         }
     }
 
     // 开启生产数据库连接的线程
-    std::thread producer(std::bind(&ConnectionPool::createConnectionThread, this));
-    producer.detach();
+    producer_ = std::thread(std::bind(&ConnectionPool::createConnectionThread, this));
+
+    // 开启维护空闲连接的线程
+    maintainer_ = std::thread(std::bind(&ConnectionPool::maintainConnectionThread, this));
+}
+
+// 只更新可以在运行中调整的几项，读取失败时保持原来的配置
+void ConnectionPool::reloadConfig() {
+    PoolConfig config;
+    if (!PoolConfig::load(kConfigFile, config)) {
+        LOG("reload mysql.conf failed, keep the old config");
+        return;
+    }
+    setConfig(config);
+}
+
+void ConnectionPool::setConfig(const PoolConfig &config) {
+    if (config.ip != ip_ || config.port != port_ || config.username != username_
+        || config.password != password_ || config.dbname != dbname_) {
+        LOG("connection settings changed, restart to apply them");
+    }
 
-    // 开启定时扫描线程
-    std::thread scanner(std::bind(&ConnectionPool::scannerConnectionThread, this));
-    scanner.detach();
+    maxSize_ = config.maxSize;
+    maxIdleTime_ = config.maxIdleTime;
+    connectionTimeout_ = config.connectionTimeout;
+    // 已经安排好的定时器不变，到期后按新的配置重新安排
+    keepAliveTime_ = config.keepAliveTime;
+    maxLifeTime_ = config.maxLifeTime;
+    validationTime_ = config.validationTime;
+    // 上限调大时生产者可能正等着，唤醒它重新检查
+    std::lock_guard<std::mutex> lock(mtx_);
+    cv_.notify_all();
 }
 
+// 有线程在排队，或者连接数不到initSize时新建，连接建立的过程不持有锁
 void ConnectionPool::createConnectionThread() {
+    int failures = 0;   // 连续失败的次数，用来退避
     while (true) {
-        std::unique_lock<std::mutex> lock(mtx_);    // TODO:感觉临界区有点大
-        while (!connections_.empty()) {
-            cv_.wait(lock);
-        }
-        
-        if (connectionNum_ < maxSize_) {
-            Connection *conn = new Connection();
-            if (conn->connect(ip_, port_, username_, password_, dbname_)) {
-                connections_.push(conn);
-                ++connectionNum_;
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            cv_.wait(lock, [this] {
+                // 有人排队说明栈里已经没有可用的连接了（被claim()的槽位不算）
+                return quit_ || (connectionNum_ < maxSize_ && (waiters_ > 0 || connectionNum_ < initSize_));
+            });
+            if (quit_) {
+                return;
             }
         }
-        cv_.notify_one();
+
+        // 先占一个名额，防止和其他地方一起超过maxSize
+        if (++connectionNum_ > maxSize_) {
+            --connectionNum_;
+            continue;
+        }
+        Connection *conn = new Connection();
+        if (conn->connect(ip_, port_, username_, password_, dbname_)) {
+            failures = 0;
+            healthy_ = true;
+            pushIdle(conn);
+            dispatch();
+        } else {
+            --connectionNum_;
+            delete conn;
+            healthy_ = false;
+            LOG("connect to mysql failed");
+            // 数据库暂时连不上，不要立刻重试，连续失败时逐渐拉长间隔，最长约6秒
+            std::unique_lock<std::mutex> lock(mtx_);
+            cv_.wait_for(lock, std::chrono::milliseconds(100) * (1 << std::min(failures++, 6)),
+                [this] { return quit_.load(); });
+        }
     }
 }
 
 // 获取连接
 std::shared_ptr<Connection> ConnectionPool::getConnection() {
+    return getConnection(std::chrono::milliseconds(connectionTimeout_));
+}
+
+std::shared_ptr<Connection> ConnectionPool::getConnection(std::chrono::milliseconds timeout) {
+    auto deadline = Clock::now() + timeout;
+    while (true) {
+        // 快速路径：没人排队时直接从无锁栈中取，有人排队时不插队
+        Connection *conn = waiters_ == 0 ? idle_.pop() : nullptr;
+        if (conn == nullptr && (conn = waitConnection(deadline)) == nullptr) {
+            LOG("获取链接超时");
+            return nullptr;
+        }
+        if (validate(conn)) {
+            return wrap(conn);
+        }
+        LOG("connection is broken, close it");
+        closeConnection(conn);
+    }
+}
+
+std::shared_ptr<Connection> ConnectionPool::tryGetConnection() {
+    while (waiters_ == 0) {
+        Connection *conn = idle_.pop();
+        if (conn == nullptr) {
+            break;
+        }
+        if (validate(conn)) {
+            return wrap(conn);
+        }
+        LOG("connection is broken, close it");
+        closeConnection(conn);
+    }
+    return nullptr;
+}
+
+std::shared_ptr<Connection> ConnectionPool::wrap(Connection *conn) {
+    ++busy_;
+    return std::shared_ptr<Connection>(conn, [this](Connection *conn) {
+        releaseConnection(conn);
+    });
+}
+
+// 排到队尾，等归还或者新建的连接直接交到手上
+Connection *ConnectionPool::waitConnection(Clock::time_point deadline) {
+    Waiter waiter;
     std::unique_lock<std::mutex> lock(mtx_);
-    while (connections_.empty()) {
-        if (cv_.wait_for(lock, std::chrono::microseconds(100)) == std::cv_status::timeout) {
-            if (connections_.empty()) {
-                LOG("获取链接超时");
-                return nullptr;
-            } 
+    waitQueue_.push_back(&waiter);
+    ++waiters_;
+    cv_.notify_one();   // 唤醒生产者
+    // 登记之前放回栈里的连接没有交给任何人，先按顺序分掉，和releaseConnection()中的fence配对
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    handOutIdle();
+    while (waiter.conn == nullptr) {
+        if (waiter.cv.wait_until(lock, deadline) == std::cv_status::timeout) {
+            break;
         }
     }
+    if (waiter.conn == nullptr) {
+        // 超时，从队列中删掉自己
+        waitQueue_.erase(std::find(waitQueue_.begin(), waitQueue_.end(), &waiter));
+        --waiters_;
+    }
+    return waiter.conn;
+}
 
-    std::shared_ptr<Connection> sp(connections_.front(), [&](Connection *conn) {
+// 持有mtx_时调用，把栈里的连接依次交给队首的线程
+void ConnectionPool::handOutIdle() {
+    while (!waitQueue_.empty()) {
+        Connection *conn = idle_.pop();
+        if (conn == nullptr) {
+            break;
+        }
+        handOut(conn);
+    }
+}
+
+// 持有mtx_时调用，队列不能为空
+void ConnectionPool::handOut(Connection *conn) {
+    Waiter *waiter = waitQueue_.front();
+    waitQueue_.pop_front();
+    --waiters_;
+    waiter->conn = conn;
+    waiter->cv.notify_one();
+}
+
+void ConnectionPool::dispatch() {
+    if (waiters_ > 0) {
         std::lock_guard<std::mutex> lock(mtx_);
-        conn->refreshTime();
-        connections_.push(conn);
-    });
-    connections_.pop();
-    cv_.notify_all();   // TODO:感觉这样设计怪怪的
-    return sp;
+        handOutIdle();
+    }
 }
 
-// 关闭空闲时间超过maxIdleTime的连接
-void ConnectionPool::scannerConnectionThread() {
-    while (true) {
-        // 每经过maxIdleTime的时间检查一次
-        std::this_thread::sleep_for(std::chrono::seconds(maxIdleTime_));
-        std::unique_lock<std::mutex> lock(mtx_);
-        while (connectionNum_ > initSize_) {
-            // 只需查看队头元素就好，后加入队列的肯定空闲时间更短
-            Connection *conn = connections_.front();
-            if (conn->getAliveTime() < maxIdleTime_ * 1000) break;
-            connections_.pop();
-            --connectionNum_;
+// 后台保活正常时连接总是刚确认过，这里很少真的去ping
+bool ConnectionPool::validate(Connection *conn) {
+    int validation = validationTime_;
+    if (validation <= 0 || Clock::now() - conn->getLastActive() < std::chrono::seconds(validation)) {
+        return true;
+    }
+    return conn->ping();
+}
+
+void ConnectionPool::closeConnection(Connection *conn) {
+    --connectionNum_;
+    delete conn;
+    if (waiters_ > 0 || connectionNum_ < initSize_) {
+        notifyProducer();
+    }
+}
+
+void ConnectionPool::releaseConnection(Connection *conn) {
+    --busy_;
+    // 借出去时打开了多语句模式的话先关掉，关不掉就是broken
+    conn->setMultiStatements(false);
+    conn->recycle();
+    if (conn->broken()) {
+        LOG("connection is broken, close it");
+        closeConnection(conn);
+        return;
+    }
+    // maxSize调小之后，多出来的连接用完就关闭
+    int num = connectionNum_;
+    while (num > maxSize_) {
+        if (connectionNum_.compare_exchange_weak(num, num - 1)) {
             delete conn;
+            return;
+        }
+    }
+    // 用得太久的连接关闭，有人在等时由生产者补上
+    Clock::time_point now = Clock::now();
+    int maxLife = maxLifeTime_;
+    if (maxLife > 0 && now - conn->getCreateTime() >= std::chrono::seconds(maxLife)) {
+        closeConnection(conn);
+        return;
+    }
+    // 有人在等就直接交给等得最久的那个，不经过栈
+    if (waiters_ > 0) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (!waitQueue_.empty()) {
+            handOut(conn);
+            return;
+        }
+    }
+    pushIdle(conn);
+    // 和waitConnection()中"先登记再检查栈"配合：放进栈之后再看一次有没有人刚开始排队
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    dispatch();
+}
+
+void ConnectionPool::pushIdle(Connection *conn) {
+    conn->refreshTime();
+    idle_.push(conn, toNanos(conn->getIdleSince()));
+}
+
+bool ConnectionPool::tryShrink() {
+    int num = connectionNum_;
+    while (num > initSize_) {
+        if (connectionNum_.compare_exchange_weak(num, num - 1)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ConnectionPool::notifyProducer() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    cv_.notify_one();
+}
+
+// 每个tick取走新放入的空闲连接安排定时器，再推进时间轮处理到期的连接。
+// 连接被取走时定时器不取消，到期时发现槽位空了或者换了连接再处理
+void ConnectionPool::maintainConnectionThread() {
+    while (!quit_) {
+        std::this_thread::sleep_for(wheel_.tick());
+
+        idle_.takeFresh([this](uint32_t idx, uint32_t, int64_t since) {
+            if (idx >= pending_.size()) {
+                pending_.resize(idx + 1);
+            }
+            // 已有的定时器一定比新连接的更早到期，到时再按新连接重新安排
+            if (pending_[idx]) {
+                return;
+            }
+            pending_[idx] = true;
+            int keepAlive = keepAliveTime_;
+            int timeout = keepAlive > 0 ? std::min(keepAlive, maxIdleTime_.load()) : maxIdleTime_.load();
+            wheel_.add(fromNanos(since) + std::chrono::seconds(timeout), idx);
+        });
+
+        wheel_.advance(Clock::now(), [this](uint64_t payload) {
+            onTimer(static_cast<uint32_t>(payload));
+        });
+        if (!probes_.empty()) {
+            probe();
         }
     }
-}
\ No newline at end of file
+}
+
+void ConnectionPool::onTimer(uint32_t idx) {
+    uint32_t gen;
+    int64_t since;
+    while (idle_.inspect(idx, gen, since)) {
+        // 槽位里可能已经换了一个空闲没多久的连接
+        int keepAlive = keepAliveTime_;
+        int timeout = keepAlive > 0 ? std::min(keepAlive, maxIdleTime_.load()) : maxIdleTime_.load();
+        Clock::time_point due = fromNanos(since) + std::chrono::seconds(timeout);
+        if (due > Clock::now()) {
+            wheel_.add(due, idx);
+            return;
+        }
+        Connection *conn = idle_.claim(idx, gen);
+        if (conn != nullptr) {
+            maintain(idx, gen, conn);
+            return;
+        }
+        // 刚被别人取走或者换了连接，重新看
+    }
+    pending_[idx] = false;
+}
+
+void ConnectionPool::maintain(uint32_t idx, uint32_t gen, Connection *conn) {
+    Clock::time_point now = Clock::now();
+    int keepAlive = keepAliveTime_;
+    int maxLife = maxLifeTime_;
+
+    bool close = false;
+    if (maxLife > 0 && now - conn->getCreateTime() >= std::chrono::seconds(maxLife)) {
+        --connectionNum_;
+        close = true;
+    } else if (now - conn->getIdleSince() >= std::chrono::seconds(maxIdleTime_) && tryShrink()) {
+        close = true;
+    }
+    if (close) {
+        // 槽位留在栈里，被pop到时跳过
+        pending_[idx] = false;
+        delete conn;
+        // 到期关闭的连接由生产者补上
+        if (waiters_ > 0 || connectionNum_ < initSize_) {
+            notifyProducer();
+        }
+        return;
+    }
+
+    if (keepAlive > 0 && now - conn->getLastActive() >= std::chrono::seconds(keepAlive)) {
+        probes_.push_back(Probe{idx, gen, conn});
+        return;
+    }
+    reschedule(idx, gen, conn);
+}
+
+void ConnectionPool::reschedule(uint32_t idx, uint32_t gen, Connection *conn) {
+    Clock::time_point now = Clock::now();
+    auto maxIdle = std::chrono::seconds(maxIdleTime_);
+    int keepAlive = keepAliveTime_;
+    int maxLife = maxLifeTime_;
+
+    // 下一次要处理的时间
+    Clock::time_point next = conn->getIdleSince() + maxIdle;
+    if (next <= now) {
+        next = now + maxIdle;
+    }
+    if (keepAlive > 0) {
+        next = std::min(next, conn->getLastActive() + std::chrono::seconds(keepAlive));
+    }
+    if (maxLife > 0) {
+        next = std::min(next, conn->getCreateTime() + std::chrono::seconds(maxLife));
+    }
+
+    if (idle_.restore(idx, gen, conn)) {
+        wheel_.add(next, idx);
+    } else {
+        // 槽位在claim()期间被pop掉了，重新放进栈，空闲时间不变
+        pending_[idx] = false;
+        idle_.push(conn, toNanos(conn->getIdleSince()));
+    }
+    // claim()期间开始等待的线程没拿到这个连接
+    dispatch();
+}
+
+// 这一批连接都已经claim()出来，ping的时候不会被别人拿走
+void ConnectionPool::probe() {
+    std::vector<Connection *> conns;
+    conns.reserve(probes_.size());
+    for (const Probe &p : probes_) {
+        conns.push_back(p.conn);
+    }
+    std::vector<bool> ok = Connection::ping(conns, kPingTimeout);
+
+    size_t alive = 0;
+    for (size_t i = 0; i < probes_.size(); ++i) {
+        const Probe &p = probes_[i];
+        if (ok[i]) {
+            ++alive;
+            reschedule(p.idx, p.gen, p.conn);
+        } else {
+            pending_[p.idx] = false;
+            closeConnection(p.conn);
+        }
+    }
+    if (alive < probes_.size()) {
+        LOG("ping mysql failed, " << probes_.size() - alive << " of " << probes_.size() << " connections closed");
+    }
+    healthy_ = alive > 0;
+    probes_.clear();
+}
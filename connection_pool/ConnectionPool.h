@@ -1,14 +1,20 @@
 #pragma once
 
 #include "Connection.h"
+#include "ConfigWatcher.h"
+#include "IdleStack.h"
+#include "PoolConfig.h"
+#include "TimerWheel.h"
 
 #include <string>
-#include <queue>
 #include <iostream>
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
 #include <memory>
+#include <thread>
+#include <vector>
+#include <deque>
 
 #define LOG(str) \
 	std::cout << __FILE__ << ":" << __LINE__ << " " << \
@@ -18,18 +24,80 @@ namespace yoko
 {
 
 /**
- * 连接池类
+ * 连接池类，一个池子对应一个后端。
+ * instance()是默认的池子，配置从mysql.conf读取，运行中修改文件后maxSize、maxIdleTime、
+ * connectionTimeOut、keepAliveTime、maxLifeTime、validationTime立即生效，其他项只在启动时读取。
+ * 连接多个后端时每个后端构造一个池子，通常由ConnectionRouter管理。
+ * 空闲连接放在无锁栈中，有空闲连接时取用和归还都不加锁。
+ * 池子空了时取连接的线程按先来后到排队，每个线程有自己的超时时间，
+ * 归还的连接直接交给等得最久的线程，不会惊群，也不会有线程一直抢不到。
+ * 空闲超时、保活和最长使用时间由维护线程用时间轮处理，每个空闲连接最多一个定时器，
+ * 到期时只claim()那一个连接，不用遍历也不用加锁，需要保活的连接攒成一批一起ping。
+ * 坏掉的和到期关闭的连接由生产者线程在后台补足到initSize，取连接的线程不用等重连
  */
 class ConnectionPool {
 public:
     static ConnectionPool *instance();
 
+    explicit ConnectionPool(const PoolConfig &config);
+    // 停止后台线程并关闭空闲连接，借出去的连接必须都已经还回来
+    ~ConnectionPool();
+
+    ConnectionPool(const ConnectionPool &) = delete;
+    ConnectionPool &operator=(const ConnectionPool &) = delete;
+
+    // 最多等connectionTimeOut毫秒，超时返回nullptr
     std::shared_ptr<Connection> getConnection();
+    std::shared_ptr<Connection> getConnection(std::chrono::milliseconds timeout);
+    // 不等待，没有空闲连接或者有人在排队时返回nullptr
+    std::shared_ptr<Connection> tryGetConnection();
+    // 后端是否正常：最近一次新建连接或者批量保活全部失败后为false，之后有一次成功就恢复
+    bool healthy() const { return healthy_; }
+    // 借出去的和正在排队的，负载均衡用
+    int outstanding() const { return busy_ + waiters_; }
+    // getConnection()默认的等待时间
+    std::chrono::milliseconds connectionTimeout() const { return std::chrono::milliseconds(connectionTimeout_); }
+
+    // 只更新可以在运行中调整的几项
+    void setConfig(const PoolConfig &config);
 private:
     ConnectionPool();
-    bool loadConfig();
+    // 建立初始连接，开启后台线程
+    void start(const PoolConfig &config);
+    // 配置文件变化时由watcher_调用
+    void reloadConfig();
+    // 归还连接，shared_ptr的删除器
+    void releaseConnection(Connection *conn);
+    // 用归还连接的删除器包装
+    std::shared_ptr<Connection> wrap(Connection *conn);
+    // 唤醒生产者
+    void notifyProducer();
+    // 池子空了时排队等到deadline，超时返回nullptr
+    Connection *waitConnection(Connection::Clock::time_point deadline);
+    // 以下两个持有mtx_时调用
+    void handOutIdle();
+    void handOut(Connection *conn);
+    // 有人排队时把栈里的连接交给他们
+    void dispatch();
+    // 取连接时检查，超过validationTime没确认过的先ping
+    bool validate(Connection *conn);
+    // 关闭一个连接，需要补充时唤醒生产者
+    void closeConnection(Connection *conn);
+    // 从现在开始空闲，放回空闲栈
+    void pushIdle(Connection *conn);
+    // 连接数大于initSize时减一，返回是否减了
+    bool tryShrink();
     void createConnectionThread();
-    void scannerConnectionThread();
+    // 以下在维护线程中执行
+    void maintainConnectionThread();
+    // 槽位idx的定时器到期
+    void onTimer(uint32_t idx);
+    // 检查claim()出来的连接，关闭、放进保活的批次或者放回
+    void maintain(uint32_t idx, uint32_t gen, Connection *conn);
+    // 放回原来的槽位并重新安排定时器
+    void reschedule(uint32_t idx, uint32_t gen, Connection *conn);
+    // 批量ping这一轮攒下的连接
+    void probe();
 
     std::string ip_; // 连接主机IP
     uint16_t port_;  // 连接端口号
@@ -37,14 +105,40 @@ private:
     std::string username_;   // mysql用户名
     std::string password_; // mysql用户密码
     int initSize_;   // 初始连接数
-    int maxSize_;    // 最大连接数
-    int maxIdleTime_;   // 最大空闲时间
-    int connectionTimeout_;    // 连接超时时间
-
-    std::queue<Connection*> connections_;
-    std::mutex mtx_;
-    std::condition_variable cv_;
-    std::atomic_int connectionNum_;     // 连接池数量
+    std::atomic_int maxSize_;    // 最大连接数
+    std::atomic_int maxIdleTime_;   // 最大空闲时间
+    std::atomic_int connectionTimeout_;    // 连接超时时间
+    std::atomic_int keepAliveTime_; // 保活间隔
+    std::atomic_int maxLifeTime_;   // 连接最长使用时间
+    std::atomic_int validationTime_;    // 取连接时检查的间隔
+
+    IdleStack idle_;    // 空闲的连接
+    // 排队等连接的线程，在自己的cv上等
+    struct Waiter {
+        std::condition_variable cv;
+        Connection *conn = nullptr;
+    };
+    std::mutex mtx_;    // 保护waitQueue_，生产者也用它等待
+    std::condition_variable cv_;    // 生产者等待
+    std::deque<Waiter *> waitQueue_;
+    std::atomic_int connectionNum_{0};     // 连接池数量
+    std::atomic_int waiters_{0};    // waitQueue_的长度，持有mtx_时修改，生产者也据此判断要不要新建连接
+    std::atomic_bool healthy_{true};
+    std::atomic_int busy_{0};   // 借出去的连接数
+    std::atomic_bool quit_{false};
+    std::thread producer_;
+    std::thread maintainer_;
+    std::unique_ptr<ConfigWatcher> watcher_;
+
+    // 只由维护线程使用
+    TimerWheel wheel_{std::chrono::milliseconds(100)};
+    std::vector<bool> pending_;     // 槽位是否已经有定时器
+    struct Probe {
+        uint32_t idx;
+        uint32_t gen;
+        Connection *conn;
+    };
+    std::vector<Probe> probes_;     // 这一轮要ping的连接，已经claim()出来
 };
 
 } // namespace yoko
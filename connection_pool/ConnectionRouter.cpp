@@ -0,0 +1,154 @@
+#include "ConnectionRouter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+
+using namespace yoko;
+
+ConnectionRouter::ConnectionRouter(Balance balance)
+    : balance_(balance) {}
+
+// 池子的析构函数会停掉各自的后台线程
+ConnectionRouter::~ConnectionRouter() = default;
+
+void ConnectionRouter::setPrimary(size_t index, const PoolConfig &config) {
+    while (shards_.size() <= index) {
+        shards_.emplace_back(new Shard());
+    }
+    shards_[index]->primary.reset(new ConnectionPool(config));
+}
+
+void ConnectionRouter::addReplica(size_t index, const PoolConfig &config, int weight) {
+    while (shards_.size() <= index) {
+        shards_.emplace_back(new Shard());
+    }
+    Shard &s = *shards_[index];
+    s.replicas.push_back(Replica{std::unique_ptr<ConnectionPool>(new ConnectionPool(config)),
+                                 weight < 1 ? 1 : weight});
+    buildSchedule(s);
+}
+
+// 平滑加权轮询（nginx的做法）：每轮每个从库的当前值加上权重，选当前值最大的，再减去权重之和。
+// 权重5:1:1得到a a b a c a a，而不是a a a a a b c。顺序只在配置时算一次，取连接时只用一个原子计数
+void ConnectionRouter::buildSchedule(Shard &shard) {
+    int total = 0;
+    for (const Replica &r : shard.replicas) {
+        total += r.weight;
+    }
+    std::vector<int> current(shard.replicas.size(), 0);
+    shard.schedule.clear();
+    for (int n = 0; n < total; ++n) {
+        size_t best = 0;
+        for (size_t i = 0; i < shard.replicas.size(); ++i) {
+            current[i] += shard.replicas[i].weight;
+            if (current[i] > current[best]) {
+                best = i;
+            }
+        }
+        current[best] -= total;
+        shard.schedule.push_back(static_cast<uint32_t>(best));
+    }
+}
+
+size_t ConnectionRouter::shardOf(const std::string &key) const {
+    if (shards_.empty()) {
+        return 0;
+    }
+    if (shardFunction_) {
+        return shardFunction_(key, shards_.size());
+    }
+    return std::hash<std::string>()(key) % shards_.size();
+}
+
+ConnectionRouter::Shard *ConnectionRouter::shard(size_t index) {
+    return index < shards_.size() ? shards_[index].get() : nullptr;
+}
+
+ConnectionPool *ConnectionRouter::primary(size_t index) const {
+    return index < shards_.size() ? shards_[index]->primary.get() : nullptr;
+}
+
+ConnectionPool *ConnectionRouter::replica(size_t index, size_t i) const {
+    if (index >= shards_.size() || i >= shards_[index]->replicas.size()) {
+        return nullptr;
+    }
+    return shards_[index]->replicas[i].pool.get();
+}
+
+ConnectionPool *ConnectionRouter::pickReplica(Shard &shard) {
+    size_t n = shard.replicas.size();
+    if (n == 0) {
+        return nullptr;
+    }
+
+    if (balance_ == WEIGHTED_ROUND_ROBIN) {
+        // 从轮到的位置往后找第一个健康的
+        size_t start = shard.next.fetch_add(1, std::memory_order_relaxed);
+        for (size_t i = 0; i < shard.schedule.size(); ++i) {
+            ConnectionPool *pool = shard.replicas[shard.schedule[(start + i) % shard.schedule.size()]].pool.get();
+            if (pool->healthy()) {
+                return pool;
+            }
+        }
+        return nullptr;
+    }
+
+    // 负载相同的从库很多（比如都空闲）时，从轮转的起点开始比较，不会总是选第一个
+    size_t start = shard.next.fetch_add(1, std::memory_order_relaxed);
+    ConnectionPool *best = nullptr;
+    int least = INT_MAX;
+    for (size_t i = 0; i < n; ++i) {
+        ConnectionPool *pool = shard.replicas[(start + i) % n].pool.get();
+        if (!pool->healthy()) {
+            continue;
+        }
+        int outstanding = pool->outstanding();
+        if (outstanding < least) {
+            least = outstanding;
+            best = pool;
+        }
+    }
+    return best;
+}
+
+std::shared_ptr<Connection> ConnectionRouter::getWriteConnection(size_t index) {
+    Shard *s = shard(index);
+    if (s == nullptr || !s->primary) {
+        LOG("shard " << index << " has no primary");
+        return nullptr;
+    }
+    return s->primary->getConnection();
+}
+
+std::shared_ptr<Connection> ConnectionRouter::getWriteConnection(const std::string &key) {
+    return getWriteConnection(shardOf(key));
+}
+
+std::shared_ptr<Connection> ConnectionRouter::getReadConnection(size_t index) {
+    Shard *s = shard(index);
+    if (s == nullptr) {
+        LOG("shard " << index << " does not exist");
+        return nullptr;
+    }
+    ConnectionPool *replica = pickReplica(*s);
+    if (!s->primary) {
+        // 没有主库可以退回，只能在从库上等
+        return replica != nullptr ? replica->getConnection() : nullptr;
+    }
+    // 从库只试一次不等待，取不到时在主库上等完剩下的时间，
+    // 总的等待时间不超过主库的connectionTimeout，不会在两边各等一次
+    auto deadline = std::chrono::steady_clock::now() + s->primary->connectionTimeout();
+    if (replica != nullptr) {
+        std::shared_ptr<Connection> conn = replica->tryGetConnection();
+        if (conn) {
+            return conn;
+        }
+    }
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+    return s->primary->getConnection(std::max(left, std::chrono::milliseconds(0)));
+}
+
+std::shared_ptr<Connection> ConnectionRouter::getReadConnection(const std::string &key) {
+    return getReadConnection(shardOf(key));
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "ConnectionPool.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace yoko
+{
+
+/**
+ * 在多个后端的连接池之上做路由：每个分片一个主库和若干从库，
+ * 写连接从主库取，读连接按负载均衡策略从从库取，没有可用的从库时退回主库。
+ * 分片从0开始连续编号，也可以用分片键（默认std::hash取模）选分片。
+ *
+ * 用法：
+ *     ConnectionRouter router(ConnectionRouter::LEAST_OUTSTANDING);
+ *     router.setPrimary(0, primaryConfig);
+ *     router.addReplica(0, replicaConfig1);
+ *     router.addReplica(0, replicaConfig2, 2);
+ *     auto conn = router.getReadConnection("user:42");
+ *
+ * 配置（setPrimary/addReplica/setShardFunction）要在开始取连接之前完成，取连接是线程安全的。
+ * 借出去的连接要在router析构之前还回来
+ */
+class ConnectionRouter {
+public:
+    enum Balance {
+        LEAST_OUTSTANDING,      // 借出去加排队的连接最少的从库
+        WEIGHTED_ROUND_ROBIN    // 按权重轮流，同一从库不会连续被选中太多次
+    };
+
+    // 分片键到分片编号，shards是分片数
+    using ShardFunction = std::function<size_t(const std::string &key, size_t shards)>;
+
+    explicit ConnectionRouter(Balance balance = LEAST_OUTSTANDING);
+    ~ConnectionRouter();
+
+    ConnectionRouter(const ConnectionRouter &) = delete;
+    ConnectionRouter &operator=(const ConnectionRouter &) = delete;
+
+    // 设置分片shard的主库，中间没有设置的分片也会占一个位置
+    void setPrimary(size_t shard, const PoolConfig &config);
+    // 给分片shard加一个从库，weight只在WEIGHTED_ROUND_ROBIN时有用，小于1时按1
+    void addReplica(size_t shard, const PoolConfig &config, int weight = 1);
+    void setShardFunction(ShardFunction function) { shardFunction_ = std::move(function); }
+
+    size_t shards() const { return shards_.size(); }
+    size_t shardOf(const std::string &key) const;
+
+    // 分片不存在、没有主库或者超时时返回nullptr
+    std::shared_ptr<Connection> getWriteConnection(size_t shard = 0);
+    std::shared_ptr<Connection> getWriteConnection(const std::string &key);
+    // 选中的从库没有空闲连接时不等待，改从主库取；没有主库时才在从库上等
+    std::shared_ptr<Connection> getReadConnection(size_t shard = 0);
+    std::shared_ptr<Connection> getReadConnection(const std::string &key);
+
+    // 直接访问某个池子，比如调整配置
+    ConnectionPool *primary(size_t shard) const;
+    ConnectionPool *replica(size_t shard, size_t index) const;
+
+private:
+    struct Replica {
+        std::unique_ptr<ConnectionPool> pool;
+        int weight;
+    };
+
+    struct Shard {
+        std::unique_ptr<ConnectionPool> primary;
+        std::vector<Replica> replicas;
+        // 平滑加权轮询预先展开的顺序，存的是replicas的下标，长度等于权重之和
+        std::vector<uint32_t> schedule;
+        std::atomic<size_t> next{0};
+    };
+
+    Shard *shard(size_t index);
+    // 选一个从库，没有健康的从库时返回nullptr
+    ConnectionPool *pickReplica(Shard &shard);
+    // 按权重重新展开schedule
+    static void buildSchedule(Shard &shard);
+
+    Balance balance_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    ShardFunction shardFunction_;
+};
+
+} // namespace yoko
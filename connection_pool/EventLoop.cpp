@@ -0,0 +1,159 @@
+#include "EventLoop.h"
+
+#include <cerrno>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+using namespace yoko;
+
+EventLoop::EventLoop()
+    : epollFd_(epoll_create1(EPOLL_CLOEXEC))
+    , wakeFd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+    , quit_(false)
+    , threadId_(std::this_thread::get_id())
+    , nextTimer_(1) {
+    if (epollFd_ < 0 || wakeFd_ < 0) {
+        throw std::runtime_error("create event loop failed");
+    }
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = wakeFd_;
+    epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeFd_, &ev);
+}
+
+EventLoop::~EventLoop() {
+    close(wakeFd_);
+    close(epollFd_);
+}
+
+void EventLoop::loop() {
+    threadId_.store(std::this_thread::get_id(), std::memory_order_release);
+    std::vector<epoll_event> events(64);
+    while (!quit_) {
+        int n = epoll_wait(epollFd_, events.data(), static_cast<int>(events.size()), nextTimeout());
+        if (n < 0 && errno != EINTR) {
+            throw std::runtime_error("epoll_wait failed");
+        }
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == wakeFd_) {
+                uint64_t cnt;
+                ssize_t ret = read(wakeFd_, &cnt, sizeof(cnt));
+                (void)ret;
+                continue;
+            }
+            // 同一轮中前面的回调可能已经unwatch了这个fd
+            auto it = handlers_.find(fd);
+            if (it != handlers_.end()) {
+                std::shared_ptr<Handler> handler = it->second;
+                (*handler)(events[i].events);
+            }
+        }
+        if (n == static_cast<int>(events.size())) {
+            events.resize(events.size() * 2);
+        }
+        runTimers();
+        runPending();
+    }
+}
+
+void EventLoop::quit() {
+    quit_ = true;
+    wakeup();
+}
+
+void EventLoop::post(Task task) {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        pending_.push_back(std::move(task));
+    }
+    wakeup();
+}
+
+bool EventLoop::watch(int fd, uint32_t events, Handler handler) {
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.fd = fd;
+    auto it = handlers_.find(fd);
+    int op = it == handlers_.end() ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+    if (epoll_ctl(epollFd_, op, fd, &ev) < 0) {
+        return false;
+    }
+    auto sp = std::make_shared<Handler>(std::move(handler));
+    if (it == handlers_.end()) {
+        handlers_.emplace(fd, std::move(sp));
+    } else {
+        it->second = std::move(sp);
+    }
+    return true;
+}
+
+void EventLoop::unwatch(int fd) {
+    if (handlers_.erase(fd)) {
+        epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+    }
+}
+
+EventLoop::TimerId EventLoop::runAfter(std::chrono::milliseconds delay, Task task) {
+    TimerId id = nextTimer_++;
+    Clock::time_point when = Clock::now() + delay;
+    timers_.emplace(TimerKey(when, id), std::move(task));
+    timerIndex_.emplace(id, when);
+    return id;
+}
+
+void EventLoop::cancel(TimerId id) {
+    auto it = timerIndex_.find(id);
+    if (it != timerIndex_.end()) {
+        timers_.erase(TimerKey(it->second, id));
+        timerIndex_.erase(it);
+    }
+}
+
+void EventLoop::wakeup() {
+    uint64_t one = 1;
+    ssize_t ret = write(wakeFd_, &one, sizeof(one));
+    (void)ret;
+}
+
+void EventLoop::runPending() {
+    std::vector<Task> tasks;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        tasks.swap(pending_);
+    }
+    for (auto &task : tasks) {
+        task();
+    }
+}
+
+void EventLoop::runTimers() {
+    Clock::time_point now = Clock::now();
+    while (!timers_.empty() && timers_.begin()->first.first <= now) {
+        auto it = timers_.begin();
+        Task task = std::move(it->second);
+        timerIndex_.erase(it->first.second);
+        timers_.erase(it);
+        task();
+    }
+}
+
+int EventLoop::nextTimeout() const {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (!pending_.empty()) {
+            return 0;
+        }
+    }
+    if (timers_.empty()) {
+        return -1;
+    }
+    auto delay = timers_.begin()->first.first - Clock::now();
+    if (delay <= Clock::duration::zero()) {
+        return 0;
+    }
+    // 向上取整，避免醒得太早又空转一轮
+    return static_cast<int>(std::chrono::ceil<std::chrono::milliseconds>(delay).count());
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace yoko
+{
+
+/**
+ * 基于epoll的事件循环，一个线程调用loop()一直运行到quit()。
+ * post()可以在任何线程调用，其他接口只能在loop线程中调用（包括回调中）
+ */
+class EventLoop {
+public:
+    using Task = std::function<void()>;
+    // 参数是epoll返回的事件
+    using Handler = std::function<void(uint32_t events)>;
+    using TimerId = uint64_t;
+
+    EventLoop();
+    ~EventLoop();
+
+    EventLoop(const EventLoop &) = delete;
+    EventLoop &operator=(const EventLoop &) = delete;
+
+    void loop();
+    // 可以在任何线程调用，loop()处理完当前这一轮事件后返回
+    void quit();
+
+    // 交给loop线程执行，按提交的顺序
+    void post(Task task);
+
+    // 监视fd，已经在监视时修改事件和回调
+    bool watch(int fd, uint32_t events, Handler handler);
+    void unwatch(int fd);
+
+    // delay之后执行一次，返回的id用来取消
+    TimerId runAfter(std::chrono::milliseconds delay, Task task);
+    void cancel(TimerId id);
+
+    // loop()开始之前，构造EventLoop的线程算作loop线程
+    bool inLoopThread() const { return std::this_thread::get_id() == threadId_.load(std::memory_order_acquire); }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    using TimerKey = std::pair<Clock::time_point, TimerId>;
+
+    void wakeup();
+    void runPending();
+    void runTimers();
+    // 到最近的定时器还有多少毫秒，没有定时器时返回-1
+    int nextTimeout() const;
+
+    int epollFd_;
+    int wakeFd_;    // eventfd，post()和quit()用它唤醒epoll_wait
+    std::atomic_bool quit_;
+    // loop()在另一个线程中开始时改写，其他线程同时在inLoopThread()中读
+    std::atomic<std::thread::id> threadId_;
+
+    mutable std::mutex mtx_;
+    std::vector<Task> pending_;
+
+    // 回调执行时可能unwatch自己，用shared_ptr保证执行期间不被释放
+    std::unordered_map<int, std::shared_ptr<Handler>> handlers_;
+    std::map<TimerKey, Task> timers_;
+    std::unordered_map<TimerId, Clock::time_point> timerIndex_;
+    TimerId nextTimer_;
+};
+
+} // namespace yoko
@@ -0,0 +1,176 @@
+#include "IdleStack.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+
+using namespace yoko;
+
+static_assert(sizeof(void *) == 8, "IdleStack packs pointers into 48 bits");
+
+IdleStack::IdleStack()
+    : idle_(kNil)
+    , free_(kNil)
+    , freshHead_(kNil)
+    , used_(0) {
+    for (auto &chunk : chunks_) {
+        chunk.store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+// 栈中剩下的连接由连接池负责释放，这里只释放槽位
+IdleStack::~IdleStack() {
+    for (auto &chunk : chunks_) {
+        delete[] chunk.load(std::memory_order_relaxed);
+    }
+}
+
+// 第k块的下标范围是[kFirstChunk * (2^k - 1), kFirstChunk * (2^(k+1) - 1))
+IdleStack::Slot &IdleStack::slot(uint32_t idx) {
+    uint32_t n = idx / kFirstChunk + 1;
+    int k = 31 - __builtin_clz(n);
+    uint32_t offset = idx - kFirstChunk * ((1u << k) - 1);
+    return chunks_[k].load(std::memory_order_acquire)[offset];
+}
+
+void IdleStack::pushSlot(std::atomic<uint64_t> &head, uint32_t idx) {
+    Slot &s = slot(idx);
+    uint64_t old = head.load(std::memory_order_relaxed);
+    uint64_t now;
+    do {
+        s.next.store(index(old), std::memory_order_relaxed);
+        now = ((old >> 32) + 1) << 32 | idx;
+    } while (!head.compare_exchange_weak(old, now, std::memory_order_release, std::memory_order_relaxed));
+}
+
+uint32_t IdleStack::popSlot(std::atomic<uint64_t> &head) {
+    uint64_t old = head.load(std::memory_order_acquire);
+    uint64_t now;
+    do {
+        uint32_t idx = index(old);
+        if (idx == kNil) {
+            return kNil;
+        }
+        // 这时槽位可能已经被别人弹出又压回，读到的next是旧的，但版本号变了，CAS会失败
+        now = ((old >> 32) + 1) << 32 | slot(idx).next.load(std::memory_order_relaxed);
+    } while (!head.compare_exchange_weak(old, now, std::memory_order_acquire, std::memory_order_acquire));
+    return index(old);
+}
+
+uint32_t IdleStack::allocSlot() {
+    uint32_t idx = popSlot(free_);
+    if (idx != kNil) {
+        return idx;
+    }
+
+    idx = used_.fetch_add(1, std::memory_order_relaxed);
+    uint32_t n = idx / kFirstChunk + 1;
+    int k = 31 - __builtin_clz(n);
+    if (k >= kMaxChunks) {
+        throw std::length_error("too many idle connections");
+    }
+    if (chunks_[k].load(std::memory_order_acquire) == nullptr) {
+        Slot *chunk = new Slot[static_cast<size_t>(kFirstChunk) << k];
+        for (size_t i = 0; i < (static_cast<size_t>(kFirstChunk) << k); ++i) {
+            chunk[i].state.store(0, std::memory_order_relaxed);
+            chunk[i].fresh.store(false, std::memory_order_relaxed);
+        }
+        Slot *expected = nullptr;
+        if (!chunks_[k].compare_exchange_strong(expected, chunk, std::memory_order_acq_rel)) {
+            delete[] chunk;
+        }
+    }
+    return idx;
+}
+
+void IdleStack::markFresh(uint32_t idx) {
+    Slot &s = slot(idx);
+    if (s.fresh.exchange(true)) {
+        return;
+    }
+    uint32_t old = freshHead_.load(std::memory_order_relaxed);
+    do {
+        s.freshNext.store(old, std::memory_order_relaxed);
+    } while (!freshHead_.compare_exchange_weak(old, idx, std::memory_order_release, std::memory_order_relaxed));
+}
+
+// 分支几乎总是不成立，比起push本身的几次CAS可以忽略。
+// 不能退回断言：release版本中高位会被pack()截掉，之后pop()出来的是别的地址
+void IdleStack::checkPointer(Connection *conn) {
+    if ((reinterpret_cast<uint64_t>(conn) & ~kPtrMask) != 0) {
+        std::fprintf(stderr, "IdleStack: connection pointer %p does not fit in 48 bits, "
+                     "5-level paging or pointer tagging is not supported\n", static_cast<void *>(conn));
+        std::abort();
+    }
+}
+
+void IdleStack::push(Connection *conn, int64_t since) {
+    checkPointer(conn);
+    uint32_t idx = allocSlot();
+    Slot &s = slot(idx);
+    s.since.store(since, std::memory_order_relaxed);
+    s.state.store(pack(gen(s.state.load(std::memory_order_relaxed)) + 1, conn));
+    pushSlot(idle_, idx);
+    markFresh(idx);
+}
+
+Connection *IdleStack::pop() {
+    while (true) {
+        uint32_t idx = popSlot(idle_);
+        if (idx == kNil) {
+            return nullptr;
+        }
+        Slot &s = slot(idx);
+        uint64_t state = s.state.load();
+        while (true) {
+            if (conn(state) != nullptr) {
+                // 和claim()竞争，谁把连接换成空谁拿到
+                if (s.state.compare_exchange_weak(state, pack(gen(state), nullptr))) {
+                    pushSlot(free_, idx);
+                    return conn(state);
+                }
+            } else {
+                // 连接被claim()取走了，代数加一作废这个槽位，之后restore()就会失败
+                if (s.state.compare_exchange_weak(state, pack(gen(state) + 1, nullptr))) {
+                    pushSlot(free_, idx);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+Connection *IdleStack::claim(uint32_t idx, uint32_t g) {
+    if (idx >= used_.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    Slot &s = slot(idx);
+    uint64_t state = s.state.load();
+    while (gen(state) == (g & 0xffff) && conn(state) != nullptr) {
+        if (s.state.compare_exchange_weak(state, pack(g, nullptr))) {
+            return conn(state);
+        }
+    }
+    return nullptr;
+}
+
+bool IdleStack::restore(uint32_t idx, uint32_t g, Connection *c) {
+    checkPointer(c);
+    Slot &s = slot(idx);
+    uint64_t expected = pack(g, nullptr);
+    return s.state.compare_exchange_strong(expected, pack(g, c));
+}
+
+bool IdleStack::inspect(uint32_t idx, uint32_t &g, int64_t &since) {
+    if (idx >= used_.load(std::memory_order_acquire)) {
+        return false;
+    }
+    Slot &s = slot(idx);
+    uint64_t state = s.state.load();
+    if (conn(state) == nullptr) {
+        return false;
+    }
+    g = gen(state);
+    since = s.since.load(std::memory_order_relaxed);
+    return true;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace yoko
+{
+
+class Connection;
+
+/**
+ * 空闲连接的无锁栈（Treiber栈），push/pop只用CAS，不加锁。
+ * 后进先出，刚归还的连接最先被取走，它的socket和服务端的缓存都还是热的。
+ *
+ * 连接本身可能随时被关闭释放，所以不能把next指针存在Connection里：
+ * 栈由槽位组成，槽位分块分配且直到析构都不释放，pop时读到过期槽位的next也是安全的。
+ * 栈顶是"版本号<<32 | 槽位下标"，每次修改版本号加一，避免ABA问题。
+ * 空闲的槽位放在另一个同样结构的栈中复用。
+ *
+ * 为了让后台线程不用遍历就能处理某一个空闲连接（超时关闭、保活），
+ * 槽位的内容是"代数<<48 | 连接指针"，每次放入新连接代数加一：
+ * claim()用槽位下标和代数把连接从槽位中取走，槽位仍然留在栈里，被pop到时跳过；
+ * restore()再原样放回去。新放入连接的槽位会记到一个列表中，由后台线程用takeFresh()取走并安排定时器
+ *
+ * 这里假设堆上的指针只用低48位：x86-64四级页表、AArch64的48位虚拟地址都满足，
+ * 五级页表把堆放到高地址或者开启了指针标签（AArch64 TBI/MTE、HWASan）时不满足。
+ * push()/restore()每次都检查，高16位不为0时打印原因后abort()，不会把截断的指针存进去
+ */
+class IdleStack {
+public:
+    IdleStack();
+    ~IdleStack();
+
+    IdleStack(const IdleStack &) = delete;
+    IdleStack &operator=(const IdleStack &) = delete;
+
+    // since是连接开始空闲的时间，由调用者决定时钟（纳秒）
+    void push(Connection *conn, int64_t since);
+    // 栈为空时返回nullptr
+    Connection *pop();
+    bool empty() const { return index(idle_.load(std::memory_order_acquire)) == kNil; }
+
+    // 槽位idx的代数仍是gen而且连接还在时取走它，否则返回nullptr
+    Connection *claim(uint32_t idx, uint32_t gen);
+    // 把claim()取走的连接放回原来的槽位，槽位已经被pop掉时返回false，这时需要重新push()
+    bool restore(uint32_t idx, uint32_t gen, Connection *conn);
+    // 读槽位idx当前的代数和空闲开始时间，槽位里没有连接时返回false
+    bool inspect(uint32_t idx, uint32_t &gen, int64_t &since);
+
+    // 依次对新放入连接的槽位调用f(idx, gen, since)，只能由一个线程调用
+    template <typename F>
+    void takeFresh(F &&f);
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> next;
+        std::atomic<uint64_t> state;    // 代数<<48 | 连接指针
+        std::atomic<int64_t> since;
+        std::atomic<uint32_t> freshNext;
+        std::atomic<bool> fresh;        // 是否已经在新放入的列表中
+    };
+
+    static constexpr uint32_t kNil = UINT32_MAX;
+    static constexpr uint32_t kFirstChunk = 64;   // 第k块有kFirstChunk << k个槽位
+    static constexpr int kMaxChunks = 26;
+    static constexpr uint64_t kPtrMask = (uint64_t(1) << 48) - 1;
+
+    static uint32_t index(uint64_t head) { return static_cast<uint32_t>(head); }
+    static uint32_t gen(uint64_t state) { return static_cast<uint32_t>(state >> 48); }
+    static Connection *conn(uint64_t state) { return reinterpret_cast<Connection *>(state & kPtrMask); }
+    // 指针放不进48位时打印原因并终止进程
+    static void checkPointer(Connection *conn);
+    static uint64_t pack(uint32_t gen, Connection *conn) {
+        return uint64_t(gen & 0xffff) << 48 | reinterpret_cast<uint64_t>(conn);
+    }
+
+    Slot &slot(uint32_t idx);
+    void pushSlot(std::atomic<uint64_t> &head, uint32_t idx);
+    uint32_t popSlot(std::atomic<uint64_t> &head);
+    // 取一个空闲槽位，没有时分配新的
+    uint32_t allocSlot();
+    void markFresh(uint32_t idx);
+
+    std::atomic<uint64_t> idle_;    // 存着连接的槽位
+    std::atomic<uint64_t> free_;    // 空闲的槽位
+    std::atomic<uint32_t> freshHead_;   // 新放入连接的槽位，多个线程放入，一个线程整体取走
+    std::atomic<uint32_t> used_;    // 已经分配出去的槽位下标
+    std::atomic<Slot *> chunks_[kMaxChunks];
+};
+
+template <typename F>
+void IdleStack::takeFresh(F &&f) {
+    uint32_t idx = freshHead_.exchange(kNil, std::memory_order_acquire);
+    while (idx != kNil) {
+        Slot &s = slot(idx);
+        uint32_t next = s.freshNext.load(std::memory_order_relaxed);
+        // 先清标记再读内容，之后的push会重新把槽位放进列表，不会漏掉
+        s.fresh.store(false);
+        uint64_t state = s.state.load();
+        if (conn(state) != nullptr) {
+            f(idx, gen(state), s.since.load(std::memory_order_relaxed));
+        }
+        idx = next;
+    }
+}
+
+} // namespace yoko
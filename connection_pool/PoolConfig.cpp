@@ -0,0 +1,110 @@
+#include "PoolConfig.h"
+#include "../xml_parser/Xml.h"
+
+#include <charconv>
+#include <fstream>
+#include <iterator>
+
+using namespace yoko;
+
+namespace
+{
+
+std::string trim(const std::string &s) {
+    const char *space = " \t\r\n";
+    size_t begin = s.find_first_not_of(space);
+    if (begin == std::string::npos) {
+        return std::string();
+    }
+    size_t end = s.find_last_not_of(space);
+    return s.substr(begin, end - begin + 1);
+}
+
+template <typename T>
+bool toNumber(const std::string &value, T &out) {
+    auto res = std::from_chars(value.data(), value.data() + value.size(), out);
+    return res.ec == std::errc() && res.ptr == value.data() + value.size();
+}
+
+// key=value格式，最后一行可以没有换行符
+bool parseText(const std::string &content, PoolConfig &config) {
+    size_t pos = 0;
+    while (pos < content.size()) {
+        size_t end = content.find('\n', pos);
+        if (end == std::string::npos) {
+            end = content.size();
+        }
+        std::string line = trim(content.substr(pos, end - pos));
+        pos = end + 1;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        size_t idx = line.find('=');
+        if (idx == std::string::npos) {
+            return false;
+        }
+        if (!config.set(trim(line.substr(0, idx)), trim(line.substr(idx + 1)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool parseXml(const std::string &content, PoolConfig &config) {
+    Xml xml;
+    if (!xml.tryLoadString(content)) {
+        return false;
+    }
+    for (const Node &node : xml.get_root()) {
+        if (!config.set(node.get_name(), trim(node.get_text()))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+bool PoolConfig::load(const std::string &filename, PoolConfig &config) {
+    std::ifstream in(filename, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    size_t first = content.find_first_not_of(" \t\r\n");
+    if (first != std::string::npos && content[first] == '<') {
+        return parseXml(content, config);
+    }
+    return parseText(content, config);
+}
+
+bool PoolConfig::set(const std::string &key, const std::string &value) {
+    if (key == "ip") {
+        ip = value;
+    } else if (key == "port") {
+        return toNumber(value, port);
+    } else if (key == "username") {
+        username = value;
+    } else if (key == "password") {
+        password = value;
+    } else if (key == "db") {
+        dbname = value;
+    } else if (key == "initSize") {
+        return toNumber(value, initSize) && initSize >= 0;
+    } else if (key == "maxSize") {
+        return toNumber(value, maxSize) && maxSize > 0;
+    } else if (key == "maxIdleTime") {
+        return toNumber(value, maxIdleTime) && maxIdleTime > 0;
+    } else if (key == "connectionTimeOut") {
+        return toNumber(value, connectionTimeout) && connectionTimeout >= 0;
+    } else if (key == "keepAliveTime") {
+        return toNumber(value, keepAliveTime) && keepAliveTime >= 0;
+    } else if (key == "maxLifeTime") {
+        return toNumber(value, maxLifeTime) && maxLifeTime >= 0;
+    } else if (key == "validationTime") {
+        return toNumber(value, validationTime) && validationTime >= 0;
+    }
+    return true;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace yoko
+{
+
+/**
+ * 连接池的配置，支持两种格式，按文件内容自动区分：
+ * key=value，每行一项，允许空行和以'#'开头的注释：
+ *     ip=127.0.0.1
+ *     port=3306
+ * xml，用yoko::Xml解析，根结点下每个子标签一项：
+ *     <mysql><ip>127.0.0.1</ip><port>3306</port></mysql>
+ * 没有出现的项保持原来的值
+ */
+struct PoolConfig {
+    std::string ip = "127.0.0.1"; // 连接主机IP
+    uint16_t port = 3306;  // 连接端口号
+    std::string dbname;    // 数据库名称
+    std::string username;   // mysql用户名
+    std::string password; // mysql用户密码
+    int initSize = 10;   // 初始连接数
+    int maxSize = 1024;    // 最大连接数
+    int maxIdleTime = 60;   // 最大空闲时间(秒)
+    int connectionTimeout = 100;    // 连接超时时间(毫秒)
+    int keepAliveTime = 0;  // 空闲连接多久ping一次(秒)，0表示不ping
+    int maxLifeTime = 0;    // 连接最长使用多久后重建(秒)，0表示不限制
+    int validationTime = 0; // 取连接时，超过这么久没确认过可用就先ping一下(秒)，0表示不检查
+
+    // 读取配置文件，文件打不开、格式错误或者数值不合法时返回false，这时config可能已经改了一部分
+    static bool load(const std::string &filename, PoolConfig &config);
+
+    // 设置一项，不认识的key忽略，数值不合法时返回false
+    bool set(const std::string &key, const std::string &value);
+};
+
+} // namespace yoko
@@ -0,0 +1,61 @@
+#include "ResultSet.h"
+
+#include <utility>
+
+using namespace yoko;
+
+ResultSet::ResultSet(MYSQL_RES *res, MYSQL *mysql, std::shared_ptr<Connection> owner)
+    : res_(res)
+    , mysql_(mysql)
+    , columns_(res ? mysql_num_fields(res) : 0)
+    , owner_(res ? std::move(owner) : nullptr) {}
+
+ResultSet::ResultSet(ResultSet &&rhs) noexcept
+    : res_(std::exchange(rhs.res_, nullptr))
+    , mysql_(rhs.mysql_)
+    , columns_(rhs.columns_)
+    , errNo_(rhs.errNo_)
+    , owner_(std::move(rhs.owner_)) {}
+
+ResultSet &ResultSet::operator=(ResultSet &&rhs) noexcept {
+    if (this != &rhs) {
+        reset();
+        res_ = std::exchange(rhs.res_, nullptr);
+        mysql_ = rhs.mysql_;
+        columns_ = rhs.columns_;
+        errNo_ = rhs.errNo_;
+        owner_ = std::move(rhs.owner_);
+    }
+    return *this;
+}
+
+void ResultSet::reset() {
+    if (res_ != nullptr) {
+        // STREAM模式下mysql_free_result会把剩下的行读完丢掉
+        mysql_free_result(res_);
+        res_ = nullptr;
+    }
+    // 结果集释放之后才能把连接还回去
+    owner_.reset();
+}
+
+std::string_view ResultSet::columnName(unsigned int i) const {
+    MYSQL_FIELD *fields = mysql_fetch_fields(res_);
+    return std::string_view(fields[i].name, fields[i].name_length);
+}
+
+bool ResultSet::next(Row &row) {
+    if (res_ == nullptr) {
+        return false;
+    }
+    MYSQL_ROW r = mysql_fetch_row(res_);
+    if (r == nullptr) {
+        // 读完了，或者流式读取时出错
+        if (mysql_ != nullptr) {
+            errNo_ = mysql_errno(mysql_);
+        }
+        return false;
+    }
+    row = Row(r, mysql_fetch_lengths(res_), columns_);
+    return true;
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <mysql/mysql.h>
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <string_view>
+#include <type_traits>
+
+namespace yoko
+{
+
+class Connection;
+
+/**
+ * 一行数据的视图，列的值直接指向客户端库的缓冲区，不拷贝。
+ * 流式结果集中只在读下一行之前有效
+ */
+class Row {
+public:
+    Row() = default;
+    Row(MYSQL_ROW row, unsigned long *lengths, unsigned int columns)
+        : row_(row), lengths_(lengths), columns_(columns) {}
+
+    unsigned int size() const { return columns_; }
+    bool isNull(unsigned int i) const { return row_[i] == nullptr; }
+    // NULL返回空的string_view
+    std::string_view operator[](unsigned int i) const {
+        return row_[i] ? std::string_view(row_[i], lengths_[i]) : std::string_view();
+    }
+
+    // 用from_chars转换，NULL或者格式不对时返回false，out不变
+    template <typename T>
+    bool get(unsigned int i, T &out) const;
+    // 转换失败时返回def
+    template <typename T>
+    T as(unsigned int i, T def = T()) const {
+        get(i, def);
+        return def;
+    }
+
+private:
+    MYSQL_ROW row_ = nullptr;
+    unsigned long *lengths_ = nullptr;
+    unsigned int columns_ = 0;
+};
+
+/**
+ * 查询结果，析构时释放MYSQL_RES。
+ * STREAM（mysql_use_result）：一行行从服务端读，不管结果多大内存都是常数，
+ *     读完之前连接上不能执行别的语句。从连接池借出的连接select得到的结果集同时持有连接，
+ *     pool->getConnection()->select(...)这样的写法在结果集释放之前连接也不会还回去；
+ * BUFFERED（mysql_store_result）：整个结果集一次读到客户端，读完后连接马上就可以做别的事。
+ *
+ * 用法：
+ *     ResultSet rs = conn->select("SELECT id, name FROM user", ResultSet::STREAM);
+ *     for (const Row &row : rs) {
+ *         long long id = row.as<long long>(0);
+ *         std::string_view name = row[1];
+ *     }
+ *     if (rs.errNo()) { ... }     // 流式读取中途出错
+ */
+class ResultSet {
+public:
+    enum Mode {
+        STREAM,
+        BUFFERED
+    };
+
+    // 单遍的迭代器，++时读下一行
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Row;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Row *;
+        using reference = const Row &;
+
+        iterator() = default;
+        explicit iterator(ResultSet *rs) : rs_(rs) { ++*this; }
+
+        reference operator*() const { return row_; }
+        pointer operator->() const { return &row_; }
+        iterator &operator++() {
+            if (!rs_->next(row_)) {
+                rs_ = nullptr;
+            }
+            return *this;
+        }
+        bool operator==(const iterator &rhs) const { return rs_ == rhs.rs_; }
+        bool operator!=(const iterator &rhs) const { return rs_ != rhs.rs_; }
+
+    private:
+        ResultSet *rs_ = nullptr;
+        Row row_;
+    };
+
+    ResultSet() = default;
+    // 接管res，mysql用来区分读完和出错。mysql_store_result的结果不会在读的过程中出错，可以传nullptr。
+    // owner为结果集所在的连接，reset()之前一直持有
+    ResultSet(MYSQL_RES *res, MYSQL *mysql, std::shared_ptr<Connection> owner = nullptr);
+    ~ResultSet() { reset(); }
+
+    ResultSet(ResultSet &&rhs) noexcept;
+    ResultSet &operator=(ResultSet &&rhs) noexcept;
+    ResultSet(const ResultSet &) = delete;
+    ResultSet &operator=(const ResultSet &) = delete;
+
+    explicit operator bool() const { return res_ != nullptr; }
+    unsigned int columns() const { return columns_; }
+    std::string_view columnName(unsigned int i) const;
+    // BUFFERED模式下为总行数，STREAM模式下为已经读了的行数
+    uint64_t rows() const { return res_ ? mysql_num_rows(res_) : 0; }
+    // 读完之后检查，流式读取中途断开等错误
+    unsigned int errNo() const { return errNo_; }
+
+    // 读下一行，没有更多的行时返回false
+    bool next(Row &row);
+
+    iterator begin() { return res_ ? iterator(this) : iterator(); }
+    iterator end() { return iterator(); }
+
+    // 提前释放，没有读完的行被丢弃，同时放开持有的连接
+    void reset();
+    MYSQL_RES *handle() const { return res_; }
+
+private:
+    MYSQL_RES *res_ = nullptr;
+    MYSQL *mysql_ = nullptr;
+    unsigned int columns_ = 0;
+    unsigned int errNo_ = 0;
+    std::shared_ptr<Connection> owner_;
+};
+
+template <typename T>
+bool Row::get(unsigned int i, T &out) const {
+    if (row_[i] == nullptr) {
+        return false;
+    }
+    std::string_view s(row_[i], lengths_[i]);
+    if constexpr (std::is_same<T, bool>::value) {
+        // BOOL/TINYINT(1)列的值是"0"或"1"
+        if (s == "0" || s == "1") {
+            out = s[0] == '1';
+            return true;
+        }
+        return false;
+    } else if constexpr (std::is_arithmetic<T>::value) {
+        T value;
+        auto res = std::from_chars(s.data(), s.data() + s.size(), value);
+        if (res.ec != std::errc() || res.ptr != s.data() + s.size()) {
+            return false;
+        }
+        out = value;
+        return true;
+    } else {
+        // std::string、std::string_view等，直接从视图构造
+        out = T(s);
+        return true;
+    }
+}
+
+} // namespace yoko
@@ -0,0 +1,102 @@
+#include "Statement.h"
+
+using namespace yoko;
+
+Statement::Statement(MYSQL_STMT *stmt, std::string sql)
+    : stmt_(stmt)
+    , sql_(std::move(sql))
+    , paramCount_(mysql_stmt_param_count(stmt))
+    , fieldCount_(mysql_stmt_field_count(stmt)) {}
+
+Statement::~Statement() {
+    mysql_stmt_close(stmt_);
+}
+
+void Statement::freeResult() {
+    if (pending_) {
+        mysql_stmt_free_result(stmt_);
+        pending_ = false;
+    }
+}
+
+bool Statement::run() {
+    freeResult();
+    if (paramCount_ > 0 && mysql_stmt_bind_param(stmt_, params_.data())) {
+        return false;
+    }
+    if (mysql_stmt_execute(stmt_)) {
+        return false;
+    }
+    pending_ = fieldCount_ > 0;
+    return true;
+}
+
+bool Statement::fetchRow() {
+    if (mysql_stmt_bind_result(stmt_, results_.data())) {
+        return false;
+    }
+    int ret = mysql_stmt_fetch(stmt_);
+    if (ret == MYSQL_NO_DATA || ret == 1) {
+        pending_ = false;
+        return false;
+    }
+
+    // 字符串列绑定时没有缓冲区，总是被截断，按长度单独读出来
+    for (size_t i = 0; i < strings_.size(); ++i) {
+        std::string *s = strings_[i];
+        if (s == nullptr) {
+            continue;
+        }
+        if (nulls_[i] || lengths_[i] == 0) {
+            s->clear();
+            continue;
+        }
+        s->resize(lengths_[i]);
+        MYSQL_BIND bind;
+        std::memset(&bind, 0, sizeof(bind));
+        bind.buffer_type = MYSQL_TYPE_STRING;
+        bind.buffer = &(*s)[0];
+        bind.buffer_length = lengths_[i];
+        if (mysql_stmt_fetch_column(stmt_, &bind, static_cast<unsigned int>(i), 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::shared_ptr<Statement> StatementCache::get(const std::string &sql) {
+    auto it = index_.find(sql);
+    if (it == index_.end()) {
+        return nullptr;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return *it->second;
+}
+
+void StatementCache::put(std::shared_ptr<Statement> stmt) {
+    auto it = index_.find(stmt->sql());
+    if (it != index_.end()) {
+        auto pos = it->second;
+        index_.erase(it);
+        lru_.erase(pos);
+    }
+    lru_.push_front(std::move(stmt));
+    // key指向Statement自己保存的sql，和它的生命周期一致
+    index_.emplace(lru_.front()->sql(), lru_.begin());
+    while (lru_.size() > capacity_) {
+        // 外面还有人在用时，等最后一个引用释放才真正关闭
+        index_.erase(lru_.back()->sql());
+        lru_.pop_back();
+    }
+}
+
+void StatementCache::clear() {
+    index_.clear();
+    lru_.clear();
+}
+
+void StatementCache::freeResults() {
+    for (const std::shared_ptr<Statement> &stmt : lru_) {
+        stmt->freeResult();
+    }
+}
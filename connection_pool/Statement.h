@@ -0,0 +1,214 @@
+#pragma once
+
+#include <mysql/mysql.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace yoko
+{
+
+/**
+ * 预处理语句，由Connection::prepare创建并缓存，参数按类型直接绑定，不用拼接字符串。
+ *
+ * 用法：
+ *     auto stmt = conn->prepare("SELECT id, name FROM user WHERE age > ? AND city = ?");
+ *     if (stmt && stmt->execute(18, city)) {
+ *         long long id;
+ *         std::string name;
+ *         while (stmt->fetch(id, name)) { ... }
+ *     }
+ *
+ * 参数可以是整数、bool、浮点数、std::string、std::string_view、const char*和nullptr（NULL）。
+ * fetch的输出可以是整数、浮点数和std::string，NULL得到0或空字符串。
+ * 结果集不缓存在客户端，没有读完时连接上不能执行别的语句，下一次execute会丢弃剩下的行，
+ * 连接还回连接池时也会丢弃。prepare()返回的指针占着连接，用完要及时释放，否则连接还不回去
+ */
+class Statement {
+public:
+    Statement(MYSQL_STMT *stmt, std::string sql);
+    ~Statement();
+
+    Statement(const Statement &) = delete;
+    Statement &operator=(const Statement &) = delete;
+
+    template <typename... Args>
+    bool execute(const Args &...args);
+
+    // 读下一行到out中，没有更多的行或者出错时返回false
+    template <typename... Args>
+    bool fetch(Args &...out);
+
+    // 丢弃没有读完的结果集
+    void freeResult();
+
+    const std::string &sql() const { return sql_; }
+    unsigned long paramCount() const { return paramCount_; }
+    uint64_t affectedRows() const { return mysql_stmt_affected_rows(stmt_); }
+    uint64_t insertId() const { return mysql_stmt_insert_id(stmt_); }
+    unsigned int errNo() const { return mysql_stmt_errno(stmt_); }
+    const char *error() const { return mysql_stmt_error(stmt_); }
+    MYSQL_STMT *handle() const { return stmt_; }
+
+private:
+    template <typename T>
+    static void bindParam(MYSQL_BIND &bind, const T &value);
+    template <typename T>
+    static void bindResult(MYSQL_BIND &bind, T &out);
+
+    // 参数已经放在params_中
+    bool run();
+    // 结果已经绑定在results_中，读一行并补上字符串列
+    bool fetchRow();
+
+    MYSQL_STMT *stmt_;
+    std::string sql_;
+    unsigned long paramCount_;
+    unsigned int fieldCount_;   // 结果集的列数，不返回结果集的语句为0
+    bool pending_ = false;      // 是否有没读完的结果集
+
+    // 每次执行复用，不重新分配
+    std::vector<MYSQL_BIND> params_;
+    std::vector<MYSQL_BIND> results_;
+    std::vector<unsigned long> lengths_;
+    std::vector<my_bool> nulls_;
+    std::vector<std::string *> strings_;   // 第i列输出到std::string时为它的地址
+};
+
+/**
+ * 按sql文本缓存预处理语句，超过容量时关闭最久没用的。
+ * 属于某个Connection，连接还回连接池后缓存仍然保留，下次取到这个连接时直接命中
+ */
+class StatementCache {
+public:
+    explicit StatementCache(size_t capacity = 64) : capacity_(capacity) {}
+
+    // 命中时移到最前面返回，否则返回nullptr
+    std::shared_ptr<Statement> get(const std::string &sql);
+    void put(std::shared_ptr<Statement> stmt);
+    void clear();
+    // 丢弃所有语句没有读完的结果集
+    void freeResults();
+    size_t size() const { return lru_.size(); }
+
+private:
+    size_t capacity_;
+    std::list<std::shared_ptr<Statement>> lru_;     // 最近用过的在前面
+    std::unordered_map<std::string_view, std::list<std::shared_ptr<Statement>>::iterator> index_;
+};
+
+template <typename T>
+void Statement::bindParam(MYSQL_BIND &bind, const T &value) {
+    std::memset(&bind, 0, sizeof(bind));
+    if constexpr (std::is_same<T, std::nullptr_t>::value) {
+        bind.buffer_type = MYSQL_TYPE_NULL;
+    } else if constexpr (std::is_same<T, bool>::value) {
+        // bool的内存表示就是0或1，可以当作TINYINT
+        bind.buffer_type = MYSQL_TYPE_TINY;
+        bind.buffer = const_cast<bool *>(&value);
+    } else if constexpr (std::is_integral<T>::value) {
+        static_assert(sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8, "unsupported integer");
+        bind.buffer_type = sizeof(T) == 1 ? MYSQL_TYPE_TINY : sizeof(T) == 2 ? MYSQL_TYPE_SHORT
+                         : sizeof(T) == 4 ? MYSQL_TYPE_LONG : MYSQL_TYPE_LONGLONG;
+        bind.buffer = const_cast<T *>(&value);
+        bind.is_unsigned = std::is_unsigned<T>::value;
+    } else if constexpr (std::is_same<T, float>::value) {
+        bind.buffer_type = MYSQL_TYPE_FLOAT;
+        bind.buffer = const_cast<float *>(&value);
+    } else if constexpr (std::is_same<T, double>::value) {
+        bind.buffer_type = MYSQL_TYPE_DOUBLE;
+        bind.buffer = const_cast<double *>(&value);
+    } else if constexpr (std::is_convertible<const T &, std::string_view>::value) {
+        std::string_view s(value);
+        bind.buffer_type = MYSQL_TYPE_STRING;
+        bind.buffer = const_cast<char *>(s.data());
+        bind.buffer_length = s.size();
+    } else {
+        static_assert(std::is_same<T, std::nullptr_t>::value, "unsupported parameter type");
+    }
+}
+
+template <typename T>
+void Statement::bindResult(MYSQL_BIND &bind, T &out) {
+    if constexpr (std::is_same<T, bool>::value) {
+        static_assert(!std::is_same<T, bool>::value, "fetch bool into an integer instead");
+    } else if constexpr (std::is_integral<T>::value) {
+        static_assert(sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8, "unsupported integer");
+        bind.buffer_type = sizeof(T) == 1 ? MYSQL_TYPE_TINY : sizeof(T) == 2 ? MYSQL_TYPE_SHORT
+                         : sizeof(T) == 4 ? MYSQL_TYPE_LONG : MYSQL_TYPE_LONGLONG;
+        bind.buffer = &out;
+        bind.is_unsigned = std::is_unsigned<T>::value;
+    } else if constexpr (std::is_same<T, float>::value) {
+        bind.buffer_type = MYSQL_TYPE_FLOAT;
+        bind.buffer = &out;
+    } else if constexpr (std::is_same<T, double>::value) {
+        bind.buffer_type = MYSQL_TYPE_DOUBLE;
+        bind.buffer = &out;
+    } else if constexpr (std::is_same<T, std::string>::value) {
+        // 先只取长度，fetchRow中再按长度读出来
+        bind.buffer_type = MYSQL_TYPE_STRING;
+        bind.buffer = nullptr;
+        bind.buffer_length = 0;
+    } else {
+        static_assert(std::is_same<T, std::string>::value, "unsupported result type");
+    }
+}
+
+template <typename... Args>
+bool Statement::execute(const Args &...args) {
+    if (sizeof...(Args) != paramCount_) {
+        return false;
+    }
+    params_.resize(sizeof...(Args));
+    size_t i = 0;
+    (bindParam(params_[i++], args), ...);
+    (void)i;
+    return run();
+}
+
+template <typename... Args>
+bool Statement::fetch(Args &...out) {
+    if (!pending_ || sizeof...(Args) != fieldCount_) {
+        return false;
+    }
+    results_.resize(sizeof...(Args));
+    lengths_.resize(sizeof...(Args));
+    nulls_.resize(sizeof...(Args));
+    strings_.assign(sizeof...(Args), nullptr);
+    size_t i = 0;
+    auto bind = [this, &i](auto &o) {
+        MYSQL_BIND &b = results_[i];
+        std::memset(&b, 0, sizeof(b));
+        b.length = &lengths_[i];
+        b.is_null = &nulls_[i];
+        bindResult(b, o);
+        if constexpr (std::is_same<std::remove_reference_t<decltype(o)>, std::string>::value) {
+            strings_[i] = &o;
+        }
+        ++i;
+    };
+    (bind(out), ...);
+    if (!fetchRow()) {
+        return false;
+    }
+
+    // NULL得到0或空字符串
+    i = 0;
+    auto clearNull = [this, &i](auto &o) {
+        if (nulls_[i++]) {
+            o = std::remove_reference_t<decltype(o)>();
+        }
+    };
+    (clearNull(out), ...);
+    return true;
+}
+
+} // namespace yoko
@@ -0,0 +1,46 @@
+#include "TimerWheel.h"
+
+using namespace yoko;
+
+TimerWheel::TimerWheel(std::chrono::milliseconds tick, Clock::time_point start)
+    : tick_(tick.count() > 0 ? tick : std::chrono::milliseconds(1))
+    , start_(start)
+    , now_(0)
+    , size_(0) {}
+
+void TimerWheel::add(Clock::time_point when, uint64_t payload) {
+    uint64_t expire = now_ + 1;
+    if (when > start_) {
+        // 向上取整，不会提前触发
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(when - start_);
+        auto tick = std::chrono::duration_cast<std::chrono::nanoseconds>(tick_);
+        uint64_t ticks = static_cast<uint64_t>((elapsed + tick - std::chrono::nanoseconds(1)) / tick);
+        if (ticks > expire) {
+            expire = ticks;
+        }
+    }
+    ++size_;
+    place(Entry{expire, payload});
+}
+
+// 层间移动时到期的定时器delta为0，放进第0层当前的格子，advance()接着就会触发
+void TimerWheel::place(Entry entry) {
+    uint64_t delta = entry.expire > now_ ? entry.expire - now_ : 0;
+    int level = 0;
+    while (level < kLevels - 1 && delta >= (uint64_t(1) << (kBits * (level + 1)))) {
+        ++level;
+    }
+    if (level == kLevels - 1 && delta >= (uint64_t(1) << (kBits * kLevels))) {
+        // 超出范围，放在最远的格子
+        entry.expire = now_ + (uint64_t(1) << (kBits * kLevels)) - 1;
+    }
+    slots_[level][(entry.expire >> (kBits * level)) & kMask].push_back(entry);
+}
+
+void TimerWheel::cascade(int level) {
+    std::vector<Entry> entries;
+    entries.swap(slots_[level][(now_ >> (kBits * level)) & kMask]);
+    for (const Entry &entry : entries) {
+        place(entry);
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace yoko
+{
+
+/**
+ * 分层时间轮，4层每层64格，第0层一格是一个tick，第l层一格是64^l个tick。
+ * 添加定时器O(1)，到期时随着时间推进逐层下移，每个定时器最多移动3次。
+ * 超出范围（64^4个tick）的定时器放在最远处，到时会提前触发，由使用者检查后重新添加。
+ * 没有取消操作：使用者在payload中带上版本号，触发时发现过期直接忽略。
+ * 不是线程安全的，只在一个线程中使用
+ */
+class TimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    TimerWheel(std::chrono::milliseconds tick, Clock::time_point start = Clock::now());
+
+    // 在when之后触发，when已经过去时在下一个tick触发
+    void add(Clock::time_point when, uint64_t payload);
+
+    // 推进到now，对所有到期的定时器调用f(payload)，f中可以再add()
+    template <typename F>
+    void advance(Clock::time_point now, F &&f);
+
+    std::chrono::milliseconds tick() const { return tick_; }
+    size_t size() const { return size_; }
+
+private:
+    static constexpr int kLevels = 4;
+    static constexpr int kBits = 6;
+    static constexpr uint64_t kSlots = uint64_t(1) << kBits;
+    static constexpr uint64_t kMask = kSlots - 1;
+
+    struct Entry {
+        uint64_t expire;    // 到期的tick
+        uint64_t payload;
+    };
+
+    void place(Entry entry);
+    // 把第level层当前格子里的定时器重新放到下面的层
+    void cascade(int level);
+
+    std::chrono::milliseconds tick_;
+    Clock::time_point start_;
+    uint64_t now_;      // 已经处理到的tick
+    size_t size_;
+    std::vector<Entry> slots_[kLevels][kSlots];
+    std::vector<Entry> firing_;
+};
+
+template <typename F>
+void TimerWheel::advance(Clock::time_point now, F &&f) {
+    if (now < start_) {
+        return;
+    }
+    uint64_t target = static_cast<uint64_t>((now - start_) / tick_);
+    while (now_ < target) {
+        ++now_;
+        // 从高层往低层移，高层移下来的可能正好落在低层当前的格子里
+        int top = 0;
+        while (top + 1 < kLevels && (now_ & ((uint64_t(1) << (kBits * (top + 1))) - 1)) == 0) {
+            ++top;
+        }
+        for (int level = top; level >= 1; --level) {
+            cascade(level);
+        }
+        // 回调中可能add()到当前格子，先换出来
+        firing_.clear();
+        firing_.swap(slots_[0][now_ & kMask]);
+        size_ -= firing_.size();
+        for (const Entry &entry : firing_) {
+            f(entry.payload);
+        }
+    }
+}
+
+} // namespace yoko
@@ -0,0 +1,177 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <boost/optional.hpp>
+#include "../xml_parser/Bind.h"
+#include "../xml_parser/Reader.h"
+
+using namespace yoko;
+using namespace std;
+
+#define CHECK(cond) \
+    if (!(cond)) { \
+        cout << __FILE__ << ":" << __LINE__ << " check failed: " #cond << endl; \
+        return 1; \
+    }
+
+struct Author {
+    string name;
+    int age = 0;
+};
+
+struct Chapter {
+    int no = 0;
+    string title;
+};
+
+struct Book {
+    int id = 0;
+    string title;
+    double price = 0;
+    bool available = false;
+    vector<string> tags;
+    boost::optional<long> stock;
+    Author author;
+    vector<Chapter> chapters;
+};
+
+namespace yoko {
+namespace bind {
+
+template <>
+struct Schema<Author> {
+    static constexpr Field fields[] = {attr<&Author::age>("age"), text<&Author::name>()};
+};
+
+template <>
+struct Schema<Chapter> {
+    static constexpr Field fields[] = {attr<&Chapter::no>("no"), elem<&Chapter::title>("title")};
+};
+
+template <>
+struct Schema<Book> {
+    static constexpr Field fields[] = {
+        attr<&Book::id>("id"),
+        elem<&Book::title>("title"),
+        elem<&Book::price>("price"),
+        attr<&Book::available>("available"),
+        elem<&Book::tags>("tag"),
+        elem<&Book::stock>("stock"),
+        child<&Book::author>("author"),
+        child<&Book::chapters>("chapter"),
+    };
+};
+
+}
+}
+
+// 记录可以在任意深度；Schema中没有的标签、属性跳过，跳过的标签里同名的子标签也不会绑定
+static const string doc =
+    "<?xml version=\"1.0\"?>\n"
+    "<library name=\"city\">\n"
+    "  <shelf>\n"
+    "    <book id=\"1\" available=\"true\" color=\"red\">\n"
+    "      <title>A &amp; B</title>\n"
+    "      <price> 12.5 </price>\n"
+    "      <tag>x</tag><!-- c --><tag>y</tag>\n"
+    "      <author age=\"+40\">Ann <![CDATA[<Lee>]]></author>\n"
+    "      <extra><title>wrong</title><price>0</price></extra>\n"
+    "      <chapter no=\"1\"><title>one</title></chapter>\n"
+    "      <chapter no=\"2\"><title>two</title></chapter>\n"
+    "    </book>\n"
+    "  </shelf>\n"
+    "  <book id=\"2\"><stock>-3</stock><available>1</available></book>\n"
+    "</library>\n";
+
+static int check_books(const vector<Book> &books) {
+    CHECK(books.size() == 2);
+    const Book &a = books[0];
+    CHECK(a.id == 1 && a.title == "A & B" && a.price == 12.5 && a.available);
+    CHECK((a.tags == vector<string>{"x", "y"}));
+    CHECK(!a.stock);
+    CHECK(a.author.name == "Ann <Lee>" && a.author.age == 40);
+    CHECK(a.chapters.size() == 2);
+    CHECK(a.chapters[0].no == 1 && a.chapters[0].title == "one");
+    CHECK(a.chapters[1].no == 2 && a.chapters[1].title == "two");
+
+    // available是属性，同名的子标签不绑定；没出现的字段保持默认值
+    const Book &b = books[1];
+    CHECK(b.id == 2 && b.title.empty() && !b.available && b.tags.empty());
+    CHECK(b.stock && *b.stock == -3);
+    CHECK(b.author.name.empty() && b.chapters.empty());
+    return 0;
+}
+
+static int test_bind() {
+    if (check_books(bind::load_string<Book>(doc, "book")) != 0) {
+        return 1;
+    }
+
+    const char *file = "bind_test.xml";
+    ofstream(file) << doc;
+    vector<Book> books = bind::load_file<Book>(file, "book");
+    remove(file);
+    if (check_books(books) != 0) {
+        return 1;
+    }
+
+    // 每次只feed几个字节，标签、实体和CDATA都会被切开
+    for (size_t chunk : {1, 2, 7}) {
+        Reader reader(256);
+        size_t pos = 0;
+        books.clear();
+        bind::for_each<Book>(reader, "book", [&books](Book &&book) { books.push_back(std::move(book)); },
+            [&](Reader &r) {
+                if (pos >= doc.size()) {
+                    r.finish();
+                    return;
+                }
+                r.feed(doc.data() + pos, min(chunk, doc.size() - pos));
+                pos += chunk;
+            });
+        if (check_books(books) != 0) {
+            return 1;
+        }
+    }
+
+    // record为空时绑定根结点
+    vector<Author> authors = bind::load_string<Author>("<author age=\"7\">Bo</author>");
+    CHECK(authors.size() == 1 && authors[0].name == "Bo" && authors[0].age == 7);
+    return 0;
+}
+
+// 值转换失败时抛出logic_error
+static int test_invalid() {
+    const char *bad[] = {
+        "<book id=\"x\"/>",
+        "<book id=\"1x\"/>",
+        "<book id=\"99999999999\"/>",
+        "<book><price>abc</price></book>",
+        "<book available=\"yes\"/>",
+        "<book><chapter no=\"\"/></book>",
+    };
+    for (const char *d : bad) {
+        bool thrown = false;
+        try {
+            bind::load_string<Book>(d, "book");
+        } catch (const logic_error &) {
+            thrown = true;
+        }
+        if (!thrown) {
+            cout << d << " should be rejected" << endl;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main() {
+    if (test_bind() != 0 || test_invalid() != 0) {
+        return 1;
+    }
+    cout << "bind_test passed" << endl;
+    return 0;
+}
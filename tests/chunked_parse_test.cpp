@@ -0,0 +1,114 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../xml_parser/Node.h"
+#include "../xml_parser/PushParser.h"
+#include "../xml_parser/Reader.h"
+#include "../xml_parser/Xml.h"
+
+using namespace yoko;
+using namespace std;
+
+#define CHECK(cond) \
+    if (!(cond)) { \
+        cout << __FILE__ << ":" << __LINE__ << " check failed: " #cond << endl; \
+        return 1; \
+    }
+
+// 按1、2和几个奇数大小切块时，标签、属性、注释、CDATA和实体引用都会被切开
+static const string doc =
+    "<?xml version=\"1.0\"?>\n"
+    "<!-- head -->\n"
+    "<root version=\"2\" title=\"x &amp; y &lt;z&gt;\">\n"
+    "  hello &lt;world&gt; &#65;&#x4e2d;\n"
+    "  <item id=\"1\" expr=\"a > b\"><![CDATA[<raw> & ]]></item>\n"
+    "  <!-- <item id=\"fake\"> -->tail &quot;q&quot;\n"
+    "  <group n=\"3\"><a><b>deep &apos;s</b><c/></a><a>x &amp; y</a></group>\n"
+    "  <data><![CDATA[]]]]><![CDATA[>]]></data>\n"
+    "  <empty/>\n"
+    "</root>\n";
+
+static const size_t chunk_sizes[] = {1, 2, 3, 7, 13, 64};
+
+// PushParser的depth=1时回调拿到整棵树，depth=2时依次拿到根的子标签
+static int test_push_parser(const Node &root) {
+    vector<string> childs;
+    for (const Node &node : root) {
+        childs.push_back(node.to_string());
+    }
+    for (size_t n : chunk_sizes) {
+        vector<string> trees;
+        PushParser whole([&](const Node &node) { trees.push_back(node.to_string()); }, 1, 256);
+        for (size_t pos = 0; pos < doc.size(); pos += n) {
+            whole.feed(doc.data() + pos, min(n, doc.size() - pos));
+        }
+        whole.finish();
+        CHECK(whole.done());
+        CHECK(trees.size() == 1 && trees[0] == root.to_string());
+
+        vector<string> items;
+        PushParser parser([&](const Node &node) { items.push_back(node.to_string()); }, 2, 256);
+        for (size_t pos = 0; pos < doc.size(); pos += n) {
+            parser.feed(doc.substr(pos, n));
+        }
+        parser.finish();
+        CHECK(items == childs);
+    }
+    return 0;
+}
+
+// 把事件序列写成字符串，相邻的TEXT合并，因为切块会把文本拆成几段
+static string read_events(size_t chunk) {
+    Reader reader(256);
+    string out;
+    string text;
+    size_t pos = 0;
+    for (;;) {
+        Reader::Event e = reader.next();
+        if (e == Reader::NEED_DATA) {
+            if (pos < doc.size()) {
+                reader.feed(doc.data() + pos, min(chunk, doc.size() - pos));
+                pos += chunk;
+            } else {
+                reader.finish();
+            }
+            continue;
+        }
+        if (e == Reader::TEXT) {
+            text += reader.value();
+            continue;
+        }
+        if (!text.empty()) {
+            out += "T[" + text + "]\n";
+            text.clear();
+        }
+        if (e == Reader::END_DOCUMENT) {
+            return out;
+        }
+        out += to_string(e) + ":" + to_string(reader.depth()) + "[" + string(reader.name()) + "][" + string(reader.value()) + "]\n";
+    }
+}
+
+static int test_reader() {
+    string expect = read_events(doc.size());
+    // 实体和CDATA在事件里已经解码
+    CHECK(expect.find("[title][x & y <z>]") != string::npos);
+    CHECK(expect.find("T[\n  hello <world> A\xe4\xb8\xad\n  ]") != string::npos);
+    CHECK(expect.find("T[<raw> & ]") != string::npos);
+    CHECK(expect.find("T[]]>]") != string::npos);
+    CHECK(expect.find("[ <item id=\"fake\"> ]") != string::npos);
+    for (size_t n : chunk_sizes) {
+        CHECK(read_events(n) == expect);
+    }
+    return 0;
+}
+
+int main() {
+    Xml xml;
+    xml.loadString(doc);
+    if (test_push_parser(xml.get_root()) != 0 || test_reader() != 0) {
+        return 1;
+    }
+    cout << "chunked_parse_test passed" << endl;
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include "../xml_parser/Node.h"
+#include "../xml_parser/Reader.h"
+#include "../xml_parser/ViewNode.h"
+#include "../xml_parser/Xml.h"
+
+using namespace yoko;
+using namespace std;
+
+#define CHECK(cond) \
+    if (!(cond)) { \
+        cout << __FILE__ << ":" << __LINE__ << " check failed: " #cond << endl; \
+        return 1; \
+    }
+
+static const string refs = "&amp; &lt; &#65; &#x4e2d;";
+static const string decoded = "& < A \xe4\xb8\xad";
+
+static const string doc =
+    "<root a=\"" + refs + "\" b=\"plain\">" + refs + "<![CDATA[&amp;<b>]]>"
+    "<c k=\"&quot;&apos;&gt;\">x</c> tail &#x1F600;</root>";
+
+// 同一个文档按COPY和VIEW两种模式加载，解码结果一样
+static int test_decode() {
+    Xml copy;
+    CHECK(copy.tryLoadString(doc, Xml::Mode::COPY).ok());
+    const Node &root = copy.get_root();
+    CHECK(root.get_attr("a") && *root.get_attr("a") == decoded);
+    CHECK(root.get_attr("b") && *root.get_attr("b") == "plain");
+    CHECK(root.get_text() == decoded + "&amp;<b> tail \xf0\x9f\x98\x80");
+    const Node &c = *root.begin();
+    CHECK(c.get_attr("k") && *c.get_attr("k") == "\"'>");
+
+    Xml view;
+    CHECK(view.tryLoadString(doc, Xml::Mode::VIEW).ok());
+    ViewNode vroot = view.get_view_root();
+    CHECK(vroot.get_attr("a") && *vroot.get_attr("a") == decoded);
+    CHECK(vroot.get_attr("b") && *vroot.get_attr("b") == "plain");
+    CHECK(vroot.get_text() == root.get_text());
+    CHECK(vroot.begin()->get_attr("k") && *vroot.begin()->get_attr("k") == "\"'>");
+    return 0;
+}
+
+// 不合法的引用在文本和属性值中都是错误，位置指向它的'&'
+static int test_invalid() {
+    const string bad[] = {"&bogus;", "&#xZZ;", "&#x110000;", "&#1114112;", "&#0;", "&#xD800;", "&#;", "a & b", "&amp"};
+    for (const string &ref : bad) {
+        const string text_doc = "<r>ok " + ref + "</r>";
+        const string attr_doc = "<r k=\"ok " + ref + "\"/>";
+        for (Xml::Mode mode : {Xml::Mode::COPY, Xml::Mode::VIEW}) {
+            Xml xml;
+            ParseResult r = xml.tryLoadString(text_doc, mode);
+            CHECK(r.code() == ParseErrc::REFERENCE);
+            CHECK(r.offset() == text_doc.find('&'));
+
+            r = xml.tryLoadString(attr_doc, mode);
+            CHECK(r.code() == ParseErrc::REFERENCE);
+            CHECK(r.offset() == attr_doc.find('&'));
+        }
+
+        for (const string &d : {text_doc, attr_doc}) {
+            Reader reader(256);
+            reader.feed(d.data(), d.size());
+            reader.finish();
+            bool thrown = false;
+            try {
+                while (reader.next() != Reader::END_DOCUMENT) {
+                }
+            } catch (const logic_error &e) {
+                thrown = string(e.what()).find("invalid reference") != string::npos;
+            }
+            CHECK(thrown);
+        }
+    }
+    return 0;
+}
+
+int main() {
+    if (test_decode() != 0 || test_invalid() != 0) {
+        return 1;
+    }
+    cout << "entity_test passed" << endl;
+    return 0;
+}
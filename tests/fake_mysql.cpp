@@ -0,0 +1,47 @@
+// 假的mysql客户端库，只实现连接池用到的函数，所有操作都立刻成功，结果集为空。
+// 用来在没有数据库的环境下测试连接池自己的逻辑
+#include <mysql/mysql.h>
+
+static char handle;     // 只用作非空的句柄，不会被访问
+
+extern "C" {
+
+MYSQL *mysql_init(MYSQL *mysql) { return mysql != nullptr ? mysql : reinterpret_cast<MYSQL *>(&handle); }
+void mysql_close(MYSQL *) {}
+int mysql_options(MYSQL *, enum mysql_option, const void *) { return 0; }
+MYSQL *mysql_real_connect(MYSQL *mysql, const char *, const char *, const char *, const char *,
+                          unsigned int, const char *, unsigned long) { return mysql; }
+int mysql_set_server_option(MYSQL *, enum enum_mysql_set_option) { return 0; }
+int mysql_ping(MYSQL *) { return 0; }
+int mysql_ping_start(int *ret, MYSQL *) { *ret = 0; return 0; }
+int mysql_ping_cont(int *ret, MYSQL *, int) { *ret = 0; return 0; }
+my_socket mysql_get_socket(MYSQL *) { return -1; }
+unsigned int mysql_errno(MYSQL *) { return 0; }
+const char *mysql_error(MYSQL *) { return ""; }
+
+int mysql_real_query(MYSQL *, const char *, unsigned long) { return 0; }
+MYSQL_RES *mysql_store_result(MYSQL *) { return nullptr; }
+MYSQL_RES *mysql_use_result(MYSQL *) { return nullptr; }
+int mysql_next_result(MYSQL *) { return -1; }
+void mysql_free_result(MYSQL_RES *) {}
+unsigned int mysql_num_fields(MYSQL_RES *) { return 0; }
+MYSQL_FIELD *mysql_fetch_fields(MYSQL_RES *) { return nullptr; }
+MYSQL_ROW mysql_fetch_row(MYSQL_RES *) { return nullptr; }
+unsigned long *mysql_fetch_lengths(MYSQL_RES *) { return nullptr; }
+my_ulonglong mysql_affected_rows(MYSQL *) { return 0; }
+my_ulonglong mysql_insert_id(MYSQL *) { return 0; }
+
+MYSQL_STMT *mysql_stmt_init(MYSQL *) { return nullptr; }
+int mysql_stmt_prepare(MYSQL_STMT *, const char *, unsigned long) { return 1; }
+my_bool mysql_stmt_close(MYSQL_STMT *) { return 0; }
+unsigned long mysql_stmt_param_count(MYSQL_STMT *) { return 0; }
+unsigned int mysql_stmt_field_count(MYSQL_STMT *) { return 0; }
+const char *mysql_stmt_error(MYSQL_STMT *) { return "not supported"; }
+my_bool mysql_stmt_bind_param(MYSQL_STMT *, MYSQL_BIND *) { return 1; }
+my_bool mysql_stmt_bind_result(MYSQL_STMT *, MYSQL_BIND *) { return 1; }
+int mysql_stmt_execute(MYSQL_STMT *) { return 1; }
+int mysql_stmt_fetch(MYSQL_STMT *) { return MYSQL_NO_DATA; }
+int mysql_stmt_fetch_column(MYSQL_STMT *, MYSQL_BIND *, unsigned int, unsigned long) { return 1; }
+my_bool mysql_stmt_free_result(MYSQL_STMT *) { return 0; }
+
+}
@@ -0,0 +1,182 @@
+#include <iostream>
+#include <atomic>
+#include <csignal>
+#include <thread>
+#include <tuple>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../connection_pool/IdleStack.h"
+
+using namespace yoko;
+using namespace std;
+
+#define CHECK(cond) \
+    if (!(cond)) { \
+        cout << __FILE__ << ":" << __LINE__ << " check failed: " #cond << endl; \
+        return 1; \
+    }
+
+// 栈只存指针，不会访问Connection，测试中用自己的结构代替
+struct Item {
+    atomic<int> owner{0};   // 同时被两个线程拿到时就不是0
+};
+
+static Connection *conn(Item *item) {
+    return reinterpret_cast<Connection *>(item);
+}
+
+static Item *item(Connection *conn) {
+    return reinterpret_cast<Item *>(conn);
+}
+
+// 单线程下的语义：后进先出，claim()取走的连接pop时跳过，槽位被pop掉之后restore()失败
+static int testBasic() {
+    IdleStack stack;
+    Item a, b, c;
+    CHECK(stack.empty());
+    CHECK(stack.pop() == nullptr);
+
+    stack.push(conn(&a), 1);
+    stack.push(conn(&b), 2);
+    CHECK(stack.pop() == conn(&b));
+    stack.push(conn(&b), 3);
+
+    // 每个新放入的槽位都会出现在fresh列表中，同一槽位只出现一次
+    vector<tuple<uint32_t, uint32_t, int64_t>> fresh;
+    stack.takeFresh([&](uint32_t idx, uint32_t gen, int64_t since) {
+        fresh.emplace_back(idx, gen, since);
+    });
+    CHECK(fresh.size() == 2);
+    uint32_t idxB = 0, genB = 0;
+    for (auto &f : fresh) {
+        if (get<2>(f) == 3) {
+            idxB = get<0>(f);
+            genB = get<1>(f);
+        }
+    }
+    int again = 0;
+    stack.takeFresh([&](uint32_t, uint32_t, int64_t) { ++again; });
+    CHECK(again == 0);
+
+    // 代数不对时claim失败，claim之后可以原样放回
+    CHECK(stack.claim(idxB, genB + 1) == nullptr);
+    CHECK(stack.claim(idxB, genB) == conn(&b));
+    CHECK(stack.claim(idxB, genB) == nullptr);
+    CHECK(stack.restore(idxB, genB, conn(&b)));
+    uint32_t gen;
+    int64_t since;
+    CHECK(stack.inspect(idxB, gen, since) && gen == genB && since == 3);
+
+    // claim期间槽位被pop跳过并作废，restore失败
+    CHECK(stack.claim(idxB, genB) == conn(&b));
+    CHECK(!stack.inspect(idxB, gen, since));
+    CHECK(stack.pop() == conn(&a));
+    CHECK(!stack.restore(idxB, genB, conn(&b)));
+    CHECK(stack.empty());
+
+    stack.push(conn(&b), 4);
+    stack.push(conn(&c), 5);
+    CHECK(stack.pop() == conn(&c));
+    CHECK(stack.pop() == conn(&b));
+    CHECK(stack.pop() == nullptr);
+    return 0;
+}
+
+// 多个线程pop/push，同时一个维护线程不停地claim/restore，
+// 任何时候一个连接只能被一个线程拿到，最后所有连接都回到栈里
+static int testStress() {
+    const int kItems = 64;
+    const int kThreads = 8;
+    const int kRounds = 100000;
+
+    IdleStack stack;
+    vector<Item> items(kItems);
+    for (auto &it : items) {
+        stack.push(conn(&it), 0);
+    }
+
+    atomic<bool> stop{false};
+    atomic<long> errors{0};
+    atomic<long> claims{0};
+    auto take = [&](Connection *c) {
+        if (item(c)->owner.exchange(1) != 0) {
+            ++errors;
+        }
+        item(c)->owner = 0;
+    };
+
+    vector<thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < kRounds; ++i) {
+                Connection *c = stack.pop();
+                if (c == nullptr) {
+                    continue;
+                }
+                take(c);
+                stack.push(c, i);
+            }
+        });
+    }
+
+    thread maintainer([&] {
+        vector<pair<uint32_t, uint32_t>> slots;
+        while (!stop) {
+            slots.clear();
+            stack.takeFresh([&](uint32_t idx, uint32_t gen, int64_t) {
+                slots.emplace_back(idx, gen);
+            });
+            for (auto &s : slots) {
+                Connection *c = stack.claim(s.first, s.second);
+                if (c == nullptr) {
+                    continue;
+                }
+                ++claims;
+                take(c);
+                if (!stack.restore(s.first, s.second, c)) {
+                    stack.push(c, 0);
+                }
+            }
+        }
+    });
+
+    for (auto &t : threads) {
+        t.join();
+    }
+    stop = true;
+    maintainer.join();
+
+    int left = 0;
+    while (Connection *c = stack.pop()) {
+        take(c);
+        ++left;
+    }
+    CHECK(errors == 0);
+    CHECK(left == kItems);
+    cout << "claims: " << claims << endl;
+    return 0;
+}
+
+// 放不进48位的指针不能被截断后存进去，在子进程中push，应该被abort()
+static int testWidePointer() {
+    pid_t pid = fork();
+    CHECK(pid >= 0);
+    if (pid == 0) {
+        IdleStack stack;
+        stack.push(reinterpret_cast<Connection *>(uint64_t(1) << 56 | 0x1000), 0);
+        _exit(0);
+    }
+    int status = 0;
+    CHECK(waitpid(pid, &status, 0) == pid);
+    CHECK(WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT);
+    return 0;
+}
+
+int main() {
+    if (testBasic() != 0 || testStress() != 0 || testWidePointer() != 0) {
+        return 1;
+    }
+    cout << "idle_stack_test passed" << endl;
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdio>
+#include "../xml_parser/Node.h"
+#include "../xml_parser/Xml.h"
+
+using namespace yoko;
+using namespace std;
+
+#define CHECK(cond) \
+    if (!(cond)) { \
+        cout << __FILE__ << ":" << __LINE__ << " check failed: " #cond << endl; \
+        return 1; \
+    }
+
+static const char *doc = "<r a=\"1\"><c>text</c></r>";
+static const char *missing = "load_error_test.missing.xml";
+
+// 成功加载之后再加载失败，不能还看到上一篇文档，根结点为空结点
+static int test_copy() {
+    Xml xml;
+    xml.loadString(doc);
+    CHECK(xml.get_root().get_name() == "r");
+    ParseResult r = xml.tryLoadFile(missing);
+    CHECK(r.code() == ParseErrc::FILE_ERROR);
+    CHECK(xml.get_root().get_name().empty());
+    CHECK(xml.get_root().empty());
+
+    xml.loadString(doc);
+    CHECK(!xml.tryLoadString("<r><c></r>"));
+    CHECK(xml.get_root().get_name().empty());
+    return 0;
+}
+
+// VIEW模式下结点指向文档缓冲区，失败之后旧的缓冲区已经释放，不能再访问
+static int test_view(bool mapped) {
+    const char *file = "load_error_test.xml";
+    ofstream(file) << doc;
+    Xml xml;
+    if (mapped) {
+        xml.loadFile(file, Xml::Mode::VIEW);
+    } else {
+        xml.loadString(doc, Xml::Mode::VIEW);
+    }
+    remove(file);
+    CHECK(xml.get_view_root().get_name() == "r");
+
+    ParseResult r = xml.tryLoadFile(missing, Xml::Mode::VIEW);
+    CHECK(r.code() == ParseErrc::FILE_ERROR);
+    CHECK(xml.get_view_root().get_name().empty());
+    CHECK(xml.get_view_root().get_text().empty());
+    CHECK(xml.get_view_root().begin() == xml.get_view_root().end());
+
+    // 失败之后可以正常加载下一篇
+    xml.loadString(doc, Xml::Mode::VIEW);
+    CHECK(xml.get_view_root().get_name() == "r");
+    return 0;
+}
+
+// 上一次是VIEW，失败的这次要求COPY，之后按COPY模式取根结点
+static int test_mode_switch() {
+    Xml xml;
+    xml.loadString(doc, Xml::Mode::VIEW);
+    CHECK(!xml.tryLoadFile(missing));
+    CHECK(xml.get_root().get_name().empty());
+    CHECK(xml.get_root().to_string() == Node().to_string());
+    return 0;
+}
+
+int main() {
+    if (test_copy() != 0 || test_view(false) != 0 || test_view(true) != 0 || test_mode_switch() != 0) {
+        return 1;
+    }
+    cout << "load_error_test passed" << endl;
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include <iostream>
+#include <string>
+#include "../xml_parser/Node.h"
+#include "../xml_parser/Xml.h"
+
+using namespace yoko;
+using namespace std;
+
+#define CHECK(cond) \
+    if (!(cond)) { \
+        cout << __FILE__ << ":" << __LINE__ << " check failed: " #cond << endl; \
+        return 1; \
+    }
+
+// 超过并行解析的阈值（1MB），顶层子标签中混着切块时容易出错的内容：
+// 属性值里的'>'和'<'、注释和CDATA里的标签、多层嵌套、顶层之间的文本
+static string make_doc() {
+    string doc = "<?xml version=\"1.0\"?>\n<!-- head -->\n<root version=\"2\">\n";
+    for (int i = 0; doc.size() < (3u << 20); ++i) {
+        string id = to_string(i);
+        switch (i % 5) {
+        case 0:
+            doc += "  <item id=\"" + id + "\" expr=\"a > b\" alt=\"<x/>\">text " + id + "</item>\n";
+            break;
+        case 1:
+            doc += "  <!-- <item id=\"fake\"> -->\n  <group n=\"" + id + "\"><a><b>deep</b><c/></a><a>x &amp; y</a></group>\n";
+            break;
+        case 2:
+            doc += "  <data><![CDATA[<not><a><tag>]]></data>\n";
+            break;
+        case 3:
+            doc += "  loose text " + id + "\n  <empty/>\n";
+            break;
+        default:
+            doc += "  <record id=\"" + id + "\"><name>n" + id + "</name><value>" + to_string(i * 7) + "</value></record>\n";
+            break;
+        }
+    }
+    doc += "</root>\n";
+    return doc;
+}
+
+static string parse_copy(const string &doc, unsigned threads) {
+    Xml xml;
+    xml.set_threads(threads);
+    xml.loadString(doc);
+    return xml.get_root().to_string();
+}
+
+static string parse_view(const string &doc, unsigned threads) {
+    Xml xml;
+    xml.set_threads(threads);
+    xml.loadString(doc, Xml::Mode::VIEW);
+    return xml.get_view_root().to_string();
+}
+
+// 并行解析的结果和串行的完全一样
+static int test_same_tree() {
+    string doc = make_doc();
+    string serial = parse_copy(doc, 1);
+    CHECK(serial.size() > (1u << 20));
+    for (unsigned threads : {2u, 4u, 7u, 0u}) {
+        CHECK(parse_copy(doc, threads) == serial);
+    }
+    string serial_view = parse_view(doc, 1);
+    CHECK(serial_view == serial);
+    CHECK(parse_view(doc, 4) == serial_view);
+    return 0;
+}
+
+// 出错的文档在并行解析时报告和串行一样的错误和位置
+static int test_same_error() {
+    string doc = make_doc();
+    string bad[] = {
+        doc.substr(0, doc.size() / 2) + "<oops></item>" + doc.substr(doc.size() / 2),
+        doc.substr(0, doc.size() - 8),                      // 缺少根结点的结束标签
+        doc.substr(0, doc.size() / 3) + "<a b=\"1></a>" + doc.substr(doc.size() / 3),
+    };
+    for (const string &b : bad) {
+        Xml serial;
+        ParseResult expect = serial.tryLoadString(b);
+        CHECK(!expect);
+        Xml parallel;
+        parallel.set_threads(4);
+        ParseResult got = parallel.tryLoadString(b);
+        CHECK(!got);
+        CHECK(got.code() == expect.code());
+        CHECK(got.offset() == expect.offset());
+    }
+    return 0;
+}
+
+int main() {
+    if (test_same_tree() != 0 || test_same_error() != 0) {
+        return 1;
+    }
+    cout << "parallel_parse_test passed" << endl;
+    return 0;
+}
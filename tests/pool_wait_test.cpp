@@ -0,0 +1,151 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../connection_pool/ConnectionPool.h"
+
+using namespace yoko;
+using namespace std;
+
+#define CHECK(cond) \
+    if (!(cond)) { \
+        cout << __FILE__ << ":" << __LINE__ << " check failed: " #cond << endl; \
+        return 1; \
+    }
+
+using ms = chrono::milliseconds;
+
+// 连接由fake_mysql.cpp提供，不需要数据库
+static PoolConfig config(int size) {
+    PoolConfig config;
+    config.initSize = size;
+    config.maxSize = size;
+    return config;
+}
+
+// 最多等2秒直到cond成立
+static bool waitFor(const function<bool()> &cond) {
+    auto deadline = chrono::steady_clock::now() + chrono::seconds(2);
+    while (!cond()) {
+        if (chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        this_thread::sleep_for(ms(1));
+    }
+    return true;
+}
+
+// 依次排队的线程按排队的顺序拿到归还的连接
+static int testFifo() {
+    const int kWaiters = 8;
+    ConnectionPool pool(config(1));
+    shared_ptr<Connection> held = pool.getConnection();
+    CHECK(held != nullptr);
+    CHECK(pool.tryGetConnection() == nullptr);
+
+    mutex mtx;
+    vector<int> order;
+    vector<thread> threads;
+    for (int i = 0; i < kWaiters; ++i) {
+        threads.emplace_back([&, i] {
+            shared_ptr<Connection> conn = pool.getConnection(chrono::seconds(10));
+            lock_guard<mutex> lock(mtx);
+            order.push_back(conn != nullptr ? i : -1);
+        });
+        // 前一个排上队之后再开始下一个
+        CHECK(waitFor([&] { return pool.outstanding() == i + 2; }));
+    }
+    held.reset();
+    for (auto &t : threads) {
+        t.join();
+    }
+    CHECK(order.size() == kWaiters);
+    for (int i = 0; i < kWaiters; ++i) {
+        CHECK(order[i] == i);
+    }
+    CHECK(pool.outstanding() == 0);
+    return 0;
+}
+
+// 超时的线程从队列中删掉自己，之后归还的连接交给排在它后面的线程
+static int testTimeout() {
+    ConnectionPool pool(config(1));
+    shared_ptr<Connection> held = pool.getConnection();
+    CHECK(held != nullptr);
+
+    mutex mtx;
+    vector<int> order;
+    auto waiter = [&](int id, ms timeout) {
+        return thread([&, id, timeout] {
+            shared_ptr<Connection> conn = pool.getConnection(timeout);
+            lock_guard<mutex> lock(mtx);
+            order.push_back(conn != nullptr ? id : -id);
+        });
+    };
+
+    thread first = waiter(1, ms(10000));
+    CHECK(waitFor([&] { return pool.outstanding() == 2; }));
+    thread middle = waiter(2, ms(50));
+    CHECK(waitFor([&] { return pool.outstanding() == 3; }));
+    thread last = waiter(3, ms(10000));
+    CHECK(waitFor([&] { return pool.outstanding() == 4; }));
+
+    // 中间的超时退出
+    middle.join();
+    CHECK(pool.outstanding() == 3);
+    CHECK(order.size() == 1 && order[0] == -2);
+
+    held.reset();
+    first.join();
+    last.join();
+    CHECK(order.size() == 3 && order[1] == 1 && order[2] == 3);
+    CHECK(pool.outstanding() == 0);
+    return 0;
+}
+
+// 几个线程反复抢唯一的连接，每次取到后马上归还。
+// 归还和开始排队同时发生时如果丢了唤醒，连接留在栈里没人取，所有线程都等到超时
+static int testNoLostWakeup() {
+    const int kThreads = 4;
+    const int kRounds = 20000;
+    ConnectionPool pool(config(1));
+
+    atomic<int> failures{0};
+    atomic<int> inUse{0};
+    atomic<int> overflow{0};
+    vector<thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&] {
+            // 一个线程超时之后其他线程也会超时，不用再等
+            for (int i = 0; i < kRounds && failures == 0; ++i) {
+                shared_ptr<Connection> conn = pool.getConnection(chrono::seconds(5));
+                if (conn == nullptr) {
+                    ++failures;
+                    continue;
+                }
+                if (++inUse > 1) {
+                    ++overflow;
+                }
+                --inUse;
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    CHECK(failures == 0);
+    CHECK(overflow == 0);
+    CHECK(pool.outstanding() == 0);
+    return 0;
+}
+
+int main() {
+    if (testFifo() != 0 || testTimeout() != 0 || testNoLostWakeup() != 0) {
+        return 1;
+    }
+    cout << "pool_wait_test passed" << endl;
+    return 0;
+}
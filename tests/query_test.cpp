@@ -0,0 +1,138 @@
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "../xml_parser/Node.h"
+#include "../xml_parser/Query.h"
+#include "../xml_parser/ViewNode.h"
+#include "../xml_parser/Xml.h"
+
+using namespace yoko;
+using namespace std;
+
+#define CHECK(cond) \
+    if (!(cond)) { \
+        cout << __FILE__ << ":" << __LINE__ << " check failed: " #cond << endl; \
+        return 1; \
+    }
+
+static const string doc =
+    "<root>"
+    "<item id=\"41\"><price>1</price><name>a</name></item>"
+    "<item id=\"42\"><price>2</price></item>"
+    "<group><record type=\"a\">r1</record><sub><record type=\"b\">r2</record></sub></group>"
+    "<record type=\"a\">r3</record>"
+    "<other><price>9</price></other>"
+    "</root>";
+
+// 匹配结果的文本，用','连接
+static string texts(const vector<const Node *> &nodes) {
+    string s;
+    for (const Node *node : nodes) {
+        s += (s.empty() ? "" : ",") + node->get_text();
+    }
+    return s;
+}
+
+static string texts(const vector<ViewNode> &nodes) {
+    string s;
+    for (const ViewNode &node : nodes) {
+        s += (s.empty() ? "" : ",") + string(node.get_text());
+    }
+    return s;
+}
+
+static int test_select() {
+    Xml xml;
+    xml.loadString(doc);
+    const Node &root = xml.get_root();
+    Xml view;
+    view.loadString(doc, Xml::Mode::VIEW);
+    ViewNode vroot = view.get_view_root();
+
+    const pair<string, string> cases[] = {
+        {"/root/item[@id=\"42\"]/price", "2"},
+        {"//record", "r1,r2,r3"},
+        {"//record[@type='a']", "r1,r3"},
+        // 位置谓词在每个父结点下单独计数
+        {"//record[@type][1]", "r1,r2,r3"},
+        {"/root/item[2]/price", "2"},
+        {"/root/item[@id]/price", "1,2"},
+        {"/root/*/price", "1,2,9"},
+        {"item/price", "1,2"},
+        {"//price", "1,2,9"},
+        {"/root/item[@id=\"43\"]", ""},
+        {"/item", ""},
+    };
+    for (const auto &c : cases) {
+        Query q(c.first);
+        if (texts(q.select(root)) != c.second || texts(q.select(vroot)) != c.second) {
+            cout << "query " << c.first << " expect " << c.second << " got " << texts(q.select(root))
+                 << " / " << texts(q.select(vroot)) << endl;
+            return 1;
+        }
+    }
+
+    // 同一个Query可以反复使用
+    Query q("//record[@type='a']");
+    CHECK(texts(q.select(root)) == "r1,r3");
+    CHECK(texts(q.select(root)) == "r1,r3");
+    CHECK(q.select_one(root) && q.select_one(root)->get_text() == "r1");
+    CHECK(Query("/root/none").select_one(root) == nullptr);
+
+    for (const char *bad : {"", "/root[", "/root/item[@id=\"1]", "/root/item[0]", "/root//", "/root/[1]"}) {
+        bool thrown = false;
+        try {
+            Query query(bad);
+        } catch (const invalid_argument &) {
+            thrown = true;
+        }
+        if (!thrown) {
+            cout << "query " << bad << " should be rejected" << endl;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// 解析时过滤：只留下匹配的结点和它们的祖先，查询结果和不过滤时一样
+static int test_filter() {
+    Query q("//record[@type='a']");
+    const string expect = "<root><group><record type=\"a\">r1</record></group><record type=\"a\">r3</record></root>";
+
+    Xml copy;
+    copy.set_filter(q);
+    copy.loadString(doc);
+    CHECK(copy.get_root().to_string() == expect);
+    CHECK(texts(q.select(copy.get_root())) == "r1,r3");
+
+    Xml view;
+    view.set_filter(q);
+    view.loadString(doc, Xml::Mode::VIEW);
+    CHECK(view.get_view_root().to_string() == expect);
+    CHECK(texts(q.select(view.get_view_root())) == "r1,r3");
+
+    // 匹配的结点连同整棵子树保留
+    Xml sub;
+    sub.set_filter(Query("/root/item[@id=\"41\"]"));
+    sub.loadString(doc);
+    CHECK(sub.get_root().to_string() == "<root><item id=\"41\"><price>1</price><name>a</name></item></root>");
+
+    // 跳过的子树也要检查标签配对
+    Xml bad;
+    bad.set_filter(q);
+    CHECK(bad.tryLoadString("<root><item><price>1</item></root>").code() == ParseErrc::TEXT);
+
+    bad.clear_filter();
+    bad.loadString(doc);
+    CHECK(texts(Query("//price").select(bad.get_root())) == "1,2,9");
+    return 0;
+}
+
+int main() {
+    if (test_select() != 0 || test_filter() != 0) {
+        return 1;
+    }
+    cout << "query_test passed" << endl;
+    return 0;
+}
@@ -0,0 +1,166 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include "../xml_parser/Node.h"
+#include "../xml_parser/Snapshot.h"
+#include "../xml_parser/ViewNode.h"
+#include "../xml_parser/Xml.h"
+
+using namespace yoko;
+using namespace std;
+
+#define CHECK(cond) \
+    if (!(cond)) { \
+        cout << __FILE__ << ":" << __LINE__ << " check failed: " #cond << endl; \
+        return 1; \
+    }
+
+static const char *file = "snapshot_test.bin";
+static const char *bad_file = "snapshot_test_bad.bin";
+
+static const string doc =
+    "<root version=\"2\" title=\"x &amp; y\">head"
+    "<item id=\"1\" kind=\"a\"><price>10</price><name>first</name></item>"
+    "<item id=\"2\"><price>20</price><empty/></item>"
+    "<group><a><b>deep</b></a>mid<c/>tail</group>"
+    "</root>";
+
+static string read_file(const char *name) {
+    ifstream in(name, ios::binary);
+    ostringstream out;
+    out << in.rdbuf();
+    return out.str();
+}
+
+static void write_file(const char *name, const string &data) {
+    ofstream(name, ios::binary | ios::trunc) << data;
+}
+
+// 加载快照，被拒绝时返回false，之后Xml仍然可以用
+static bool load(Xml &xml, const char *name, Xml::Mode mode) {
+    try {
+        xml.loadSnapshot(name, mode);
+        return true;
+    } catch (const runtime_error &) {
+        return false;
+    }
+}
+
+// COPY、VIEW两种模式保存的快照，用两种模式加载出来都和原文档一样
+static int test_round_trip() {
+    Xml origin;
+    origin.loadString(doc);
+    const string expect = origin.get_root().to_string();
+
+    for (Xml::Mode save_mode : {Xml::Mode::COPY, Xml::Mode::VIEW}) {
+        Xml src;
+        src.loadString(doc, save_mode);
+        src.saveSnapshot(file);
+
+        Xml copy;
+        CHECK(load(copy, file, Xml::Mode::COPY));
+        CHECK(copy.get_root().to_string() == expect);
+
+        Xml view;
+        CHECK(load(view, file, Xml::Mode::VIEW));
+        CHECK(view.get_view_root().to_string() == expect);
+        boost::optional<string_view> title = view.get_view_root().get_attr("title");
+        CHECK(title && *title == "x & y");
+    }
+    return 0;
+}
+
+// 截断、改头部、改结点表都要被拒绝；随机改坏的快照要么被拒绝，要么可以安全遍历
+static int test_corrupt() {
+    Xml src;
+    src.loadString(doc);
+    src.saveSnapshot(file);
+    const string good = read_file(file);
+
+    snapshot::Header header;
+    CHECK(good.size() > sizeof(header));
+    memcpy(&header, good.data(), sizeof(header));
+    const size_t nodes_off = (sizeof(header) + header.pool_size + 7) / 8 * 8;
+    CHECK(header.node_count > 2);
+
+    auto rejected = [&](const string &data) {
+        write_file(bad_file, data);
+        Xml xml;
+        bool ok = load(xml, bad_file, Xml::Mode::VIEW);
+        // 被拒绝后根结点是空的
+        return !ok && xml.get_view_root().get_name().empty() && xml.get_view_root().empty();
+    };
+    // 改结点表中第i个结点
+    auto patch_node = [&](size_t i, void (*patch)(ViewTable::Rec &)) {
+        string data = good;
+        ViewTable::Rec rec;
+        memcpy(&rec, data.data() + nodes_off + i * sizeof(rec), sizeof(rec));
+        patch(rec);
+        memcpy(&data[nodes_off + i * sizeof(rec)], &rec, sizeof(rec));
+        return data;
+    };
+
+    CHECK(rejected(""));
+    CHECK(rejected(good.substr(0, sizeof(header))));
+    CHECK(rejected(good.substr(0, good.size() - 1)));
+    CHECK(rejected(good + '\0'));
+
+    string data = good;
+    data[0] ^= 1;
+    CHECK(rejected(data));
+    data = good;
+    reinterpret_cast<snapshot::Header *>(&data[0])->version += 1;
+    CHECK(rejected(data));
+    data = good;
+    reinterpret_cast<snapshot::Header *>(&data[0])->node_count += 1;
+    CHECK(rejected(data));
+
+    CHECK(rejected(patch_node(1, [](ViewTable::Rec &r) { r.name.off = 0x7fffffff; })));
+    CHECK(rejected(patch_node(1, [](ViewTable::Rec &r) { r.text.len += 0x10000; })));
+    CHECK(rejected(patch_node(1, [](ViewTable::Rec &r) { r.attr_cnt = 1000; })));
+    // 指向自己或者前面的结点会成环
+    CHECK(rejected(patch_node(1, [](ViewTable::Rec &r) { r.first_child = 1; })));
+    CHECK(rejected(patch_node(2, [](ViewTable::Rec &r) { r.next_sibling = 0; })));
+    CHECK(rejected(patch_node(0, [](ViewTable::Rec &r) { r.next_sibling = 1; })));
+    CHECK(rejected(patch_node(1, [](ViewTable::Rec &r) { r.first_child = 1000; })));
+
+    mt19937 rng(42);
+    for (int i = 0; i < 2000; ++i) {
+        data = good;
+        for (int n = rng() % 4 + 1; n > 0; --n) {
+            data[rng() % data.size()] = char(rng());
+        }
+        write_file(bad_file, data);
+        for (Xml::Mode mode : {Xml::Mode::COPY, Xml::Mode::VIEW}) {
+            Xml xml;
+            if (load(xml, bad_file, mode)) {
+                string s = mode == Xml::Mode::COPY ? xml.get_root().to_string() : xml.get_view_root().to_string();
+                CHECK(!s.empty());
+            }
+        }
+    }
+
+    // 拒绝之后同一个对象还能加载好的快照
+    Xml xml;
+    write_file(bad_file, good.substr(0, good.size() / 2));
+    CHECK(!load(xml, bad_file, Xml::Mode::VIEW));
+    CHECK(load(xml, file, Xml::Mode::VIEW));
+    CHECK(xml.get_view_root().get_name() == "root");
+    return 0;
+}
+
+int main() {
+    int ret = test_round_trip() != 0 || test_corrupt() != 0;
+    remove(file);
+    remove(bad_file);
+    if (ret != 0) {
+        return 1;
+    }
+    cout << "snapshot_test passed" << endl;
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "../connection_pool/TimerWheel.h"
+
+using namespace yoko;
+using namespace std;
+
+#define CHECK(cond) \
+    if (!(cond)) { \
+        cout << __FILE__ << ":" << __LINE__ << " check failed: " #cond << endl; \
+        return 1; \
+    }
+
+using Clock = TimerWheel::Clock;
+using ms = chrono::milliseconds;
+
+// 跨越各层边界的定时器都在正确的tick触发：不早于到期时间，不晚于一个tick
+static int testCascade() {
+    Clock::time_point start = Clock::now();
+    TimerWheel wheel(ms(10), start);
+
+    // 第0层、层间边界、第1/2/3层的延迟（单位tick）
+    vector<int64_t> delays = {0, 1, 63, 64, 65, 127, 4095, 4096, 4097, 262143, 262144, 300000};
+    mt19937 rng(42);
+    for (int i = 0; i < 2000; ++i) {
+        delays.push_back(rng() % 400000);
+    }
+    vector<int64_t> due(delays.size());
+    for (size_t i = 0; i < delays.size(); ++i) {
+        due[i] = delays[i] * 10 + 5;    // 不在tick边界上，应该向上取整
+        wheel.add(start + ms(due[i]), i);
+    }
+    CHECK(wheel.size() == delays.size());
+
+    vector<int64_t> fired(delays.size(), -1);
+    int errors = 0;
+    int64_t now = 0;
+    while (wheel.size() > 0 && now < 500000 * 10) {
+        now += 37;  // 推进的步长和tick不对齐
+        wheel.advance(start + ms(now), [&](uint64_t id) {
+            if (fired[id] != -1) {
+                ++errors;
+            }
+            fired[id] = now;
+        });
+    }
+    for (size_t i = 0; i < due.size(); ++i) {
+        // 不能提前触发；推进一步最多37ms，向上取整到tick最多再晚10ms
+        if (fired[i] < due[i] || fired[i] > due[i] + 37 + 10) {
+            cout << "timer " << i << " due " << due[i] << " fired " << fired[i] << endl;
+            ++errors;
+        }
+    }
+    CHECK(errors == 0);
+    return 0;
+}
+
+// 回调中加入的定时器，包括已经过期的，在之后的tick触发，不会丢失也不会在当前回调中重入
+static int testAddInCallback() {
+    Clock::time_point start = Clock::now();
+    TimerWheel wheel(ms(10), start);
+    wheel.add(start + ms(100), 0);
+    int fired = 0;
+    int64_t now = 0;
+    while (now < 10000) {
+        now += 10;
+        wheel.advance(start + ms(now), [&](uint64_t id) {
+            ++fired;
+            if (id < 5) {
+                // 一个过期的和一个跨层的
+                wheel.add(start + ms(now - 50), 100 + id);
+                wheel.add(start + ms(now + 1000), id + 1);
+            }
+        });
+    }
+    CHECK(fired == 11);
+    CHECK(wheel.size() == 0);
+    return 0;
+}
+
+// 超出范围的定时器放在最远处，提前触发，由使用者检查后重新添加
+static int testOverflow() {
+    Clock::time_point start = Clock::now();
+    TimerWheel wheel(ms(1), start);
+    int64_t span = int64_t(1) << 24;    // 64^4个tick
+    wheel.add(start + ms(span * 2), 1);
+    bool fired = false;
+    wheel.advance(start + ms(span), [&](uint64_t) { fired = true; });
+    CHECK(fired);
+    return 0;
+}
+
+int main() {
+    if (testCascade() != 0 || testAddInCallback() != 0 || testOverflow() != 0) {
+        return 1;
+    }
+    cout << "timer_wheel_test passed" << endl;
+    return 0;
+}
@@ -0,0 +1,139 @@
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include "../xml_parser/Node.h"
+#include "../xml_parser/ViewNode.h"
+#include "../xml_parser/Writer.h"
+#include "../xml_parser/Xml.h"
+
+using namespace yoko;
+using namespace std;
+
+#define CHECK(cond) \
+    if (!(cond)) { \
+        cout << __FILE__ << ":" << __LINE__ << " check failed: " #cond << endl; \
+        return 1; \
+    }
+
+static string write(const Node &node, Writer::Style style = Writer::COMPACT) {
+    string out;
+    Writer writer(out, style);
+    writer.write(node);
+    return out;
+}
+
+// 需要转义的字符都在：文本中的& < >，属性值中的"，文本中的"和'不转义
+static Node make_tree() {
+    Node root;
+    root.set_name("root");
+    root["q"] = "say \"hi\" & <bye>";
+    root["plain"] = "it's";
+    root.set_text("a < b && c > d \"x\" 'y'");
+    Node &child = root.add_node();
+    child.set_name("c");
+    child.set_text("&amp; is not decoded twice");
+    Node &empty = root.add_node();
+    empty.set_name("e");
+    empty["v"] = "";
+    return root;
+}
+
+static int test_escape() {
+    Node root = make_tree();
+    const string out = write(root);
+    CHECK(out == "<root q=\"say &quot;hi&quot; &amp; &lt;bye&gt;\" plain=\"it's\">"
+                 "a &lt; b &amp;&amp; c &gt; d \"x\" 'y'"
+                 "<c>&amp;amp; is not decoded twice</c><e v=\"\"/></root>");
+
+    // 写出去再读回来和原来的树一样，两种模式都是
+    for (Xml::Mode mode : {Xml::Mode::COPY, Xml::Mode::VIEW}) {
+        Xml xml;
+        CHECK(xml.tryLoadString(out, mode).ok());
+        string again;
+        Writer writer(again);
+        if (mode == Xml::Mode::COPY) {
+            const Node &r = xml.get_root();
+            CHECK(*r.get_attr("q") == "say \"hi\" & <bye>");
+            CHECK(r.get_text() == root.get_text());
+            CHECK(r.begin()->get_text() == "&amp; is not decoded twice");
+            writer.write(r);
+        } else {
+            ViewNode r = xml.get_view_root();
+            CHECK(*r.get_attr("q") == "say \"hi\" & <bye>");
+            CHECK(r.get_text() == root.get_text());
+            writer.write(r);
+        }
+        CHECK(again == out);
+    }
+    return 0;
+}
+
+// PRETTY模式只改空白符，转义和COMPACT一样
+static int test_pretty() {
+    Xml xml;
+    xml.loadString("<r a=\"&lt;\">\n  x  &amp;\n  y <b>1 &gt; 0</b><e/></r>");
+    const string out = write(xml.get_root(), Writer::PRETTY);
+    CHECK(out == "<r a=\"&lt;\">\n"
+                 "    x &amp; y\n"
+                 "    <b>1 &gt; 0</b>\n"
+                 "    <e/>\n"
+                 "</r>\n");
+    Xml again;
+    CHECK(again.tryLoadString(out).ok());
+    CHECK(again.get_root().begin()->get_text() == "1 > 0");
+    return 0;
+}
+
+// 输出到fd、FILE*和回调的内容和输出到字符串一样，超过flush_size时分几次写出
+static int test_sinks() {
+    Node root;
+    root.set_name("big");
+    for (int i = 0; i < 5000; ++i) {
+        Node &item = root.add_node();
+        item.set_name("item");
+        item["id"] = to_string(i) + "\"&";
+        item.set_text("<" + to_string(i) + ">");
+    }
+    const string expect = write(root);
+    CHECK(expect.size() > 2 * Writer::flush_size);
+
+    string got;
+    int calls = 0;
+    {
+        Writer writer([&](const char *p, size_t n) {
+            got.append(p, n);
+            ++calls;
+        });
+        writer.write(root);
+    }
+    CHECK(got == expect);
+    CHECK(calls > 1);
+
+    FILE *fp = tmpfile();
+    CHECK(fp != nullptr);
+    {
+        Writer writer(fp);
+        writer.write(root);
+        writer.flush();
+    }
+    fflush(fp);
+    // 再通过fd追加一份
+    {
+        Writer writer(fileno(fp));
+        writer.write(root);
+    }
+    got.assign(2 * expect.size(), '\0');
+    CHECK(pread(fileno(fp), &got[0], got.size(), 0) == ssize_t(got.size()));
+    fclose(fp);
+    CHECK(got == expect + expect);
+    return 0;
+}
+
+int main() {
+    if (test_escape() != 0 || test_pretty() != 0 || test_sinks() != 0) {
+        return 1;
+    }
+    cout << "writer_test passed" << endl;
+    return 0;
+}
@@ -0,0 +1,142 @@
+#include "Bind.h"
+#include "Scan.h"
+
+#include <stdexcept>
+
+namespace yoko {
+namespace bind {
+
+namespace detail {
+
+std::string_view trim(std::string_view s) {
+    while (!s.empty() && scan::is_space(s.front())) {
+        s.remove_prefix(1);
+    }
+    while (!s.empty() && scan::is_space(s.back())) {
+        s.remove_suffix(1);
+    }
+    return s;
+}
+
+}
+
+namespace {
+
+const Field *find(Table table, Field::Kind kind, std::string_view name) {
+    for (const Field &field : table) {
+        if (field.kind() == kind && field.name() == name) {
+            return &field;
+        }
+    }
+    return nullptr;
+}
+
+const Field *find_element(Table table, std::string_view name) {
+    for (const Field &field : table) {
+        if ((field.kind() == Field::ELEM || field.kind() == Field::CHILD) && field.name() == name) {
+            return &field;
+        }
+    }
+    return nullptr;
+}
+
+}
+
+Reader::Event Binder::pull() {
+    Reader::Event ev = m_reader.next();
+    while (ev == Reader::NEED_DATA) {
+        if (!m_refill) {
+            throw std::logic_error("document incomplete");
+        }
+        m_refill(m_reader);
+        ev = m_reader.next();
+    }
+    return ev;
+}
+
+void Binder::set(const Field &field, void *obj, std::string_view value) const {
+    if (!field.set(obj, value)) {
+        std::string info = "bind error: bad value for '";
+        info.append(field.name().data(), field.name().size());
+        info += "' at ";
+        info += std::to_string(m_reader.offset());
+        throw std::logic_error(info);
+    }
+}
+
+// 进入一个标签，field为空时整个标签跳过
+void Binder::open(const Field *field, void *obj) {
+    Frame frame;
+    if (!field) {
+        frame = Frame{SKIP, Table{nullptr, 0}, nullptr, nullptr};
+    } else if (field->kind() == Field::CHILD) {
+        Table table = field->table();
+        frame = Frame{OBJECT, table, field->enter(obj), find(table, Field::TEXT, std::string_view())};
+    } else {
+        frame = Frame{VALUE, Table{nullptr, 0}, obj, field};
+    }
+    m_frames.push_back(frame);
+    if (m_texts.size() < m_frames.size()) {
+        m_texts.resize(m_frames.size());
+    }
+    m_texts[m_frames.size() - 1].clear();
+}
+
+bool Binder::next(std::string_view record, Table table, void *obj) {
+    // 找到记录的开始标签
+    while (true) {
+        Reader::Event ev = pull();
+        if (ev == Reader::END_DOCUMENT) {
+            return false;
+        }
+        if (ev == Reader::START_ELEMENT
+            && (record.empty() ? m_reader.depth() == 1 : m_reader.name() == record)) {
+            break;
+        }
+    }
+
+    m_frames.clear();
+    m_frames.push_back(Frame{OBJECT, table, obj, find(table, Field::TEXT, std::string_view())});
+    if (m_texts.empty()) {
+        m_texts.resize(1);
+    }
+    m_texts[0].clear();
+
+    while (!m_frames.empty()) {
+        Frame &top = m_frames.back();
+        switch (pull()) {
+        case Reader::START_ELEMENT:
+            open(top.kind == OBJECT ? find_element(top.table, m_reader.name()) : nullptr, top.obj);
+            break;
+        case Reader::ATTRIBUTE:
+            // 属性紧跟在开始标签之后，栈顶就是它所在的标签
+            if (top.kind == OBJECT) {
+                if (const Field *field = find(top.table, Field::ATTR, m_reader.name())) {
+                    set(*field, top.obj, m_reader.value());
+                }
+            }
+            break;
+        case Reader::TEXT:
+            if (top.field) {
+                m_texts[m_frames.size() - 1].append(m_reader.value().data(), m_reader.value().size());
+            }
+            break;
+        case Reader::END_ELEMENT:
+            if (top.field) {
+                set(*top.field, top.obj, m_texts[m_frames.size() - 1]);
+            }
+            m_frames.pop_back();
+            break;
+        case Reader::COMMENT:
+            break;
+        case Reader::END_DOCUMENT:
+        case Reader::NEED_DATA:
+            // pull()不会返回NEED_DATA，标签没有闭合时Reader已经抛出了异常
+            throw std::logic_error("document incomplete");
+        }
+    }
+    return true;
+}
+
+}
+}
@@ -0,0 +1,292 @@
+#ifndef __YOKO_BIND_H__
+#define __YOKO_BIND_H__
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <boost/optional.hpp>
+#include "Reader.h"
+
+namespace yoko {
+namespace bind {
+
+// 把xml直接绑定到结构体：编译期描述"哪个标签、属性对应哪个成员"，
+// 解析时在Reader的事件流上直接填成员，不生成Node，数值用from_chars转换。
+//
+// 用法：
+//     struct Author { std::string name; int age; };
+//     struct Book { int id; std::string title; double price; std::vector<std::string> tags; Author author; };
+//
+//     template <> struct yoko::bind::Schema<Author> {
+//         static constexpr Field fields[] = { attr<&Author::age>("age"), text<&Author::name>() };
+//     };
+//     template <> struct yoko::bind::Schema<Book> {
+//         static constexpr Field fields[] = {
+//             attr<&Book::id>("id"),              // <book id="1">
+//             elem<&Book::title>("title"),        // <title>...</title>
+//             elem<&Book::price>("price"),
+//             elem<&Book::tags>("tag"),           // 成员是vector时每个<tag>追加一个
+//             child<&Book::author>("author"),     // 子标签绑定到另一个有Schema的结构体
+//         };
+//     };
+//
+//     std::vector<Book> books = bind::load_file<Book>("books.xml", "book");
+//
+// 成员可以是std::string、bool、整数、浮点数、有Schema的结构体，以及它们的std::vector和boost::optional。
+// Schema中没有提到的标签、属性直接跳过；值转换失败时抛出std::logic_error
+
+class Field;
+
+// 一个结构体的全部字段
+struct Table {
+    const Field *fields;
+    std::size_t count;
+
+    const Field *begin() const;
+    const Field *end() const;
+};
+
+// 由用户特化，提供static constexpr Field fields[]
+template <typename T>
+struct Schema;
+
+class Field {
+public:
+    enum Kind {
+        ATTR,   // 所在标签的属性
+        ELEM,   // 子标签的文本
+        TEXT,   // 所在标签自己的文本
+        CHILD   // 子标签，绑定到另一个结构体
+    };
+
+    // 把value转换后写到obj的成员中，转换失败返回false
+    typedef bool (*Setter)(void *obj, std::string_view value);
+    // 返回obj中子结构体的地址，成员是vector时先追加一个
+    typedef void *(*Enter)(void *obj);
+    typedef Table (*GetTable)();
+
+    constexpr Field(Kind kind, std::string_view name, Setter set)
+        : m_kind(kind), m_name(name), m_set(set), m_enter(nullptr), m_table(nullptr) {}
+    constexpr Field(std::string_view name, Enter enter, GetTable table)
+        : m_kind(CHILD), m_name(name), m_set(nullptr), m_enter(enter), m_table(table) {}
+
+    Kind kind() const { return m_kind; }
+    std::string_view name() const { return m_name; }
+    bool set(void *obj, std::string_view value) const { return m_set(obj, value); }
+    void *enter(void *obj) const { return m_enter(obj); }
+    Table table() const { return m_table(); }
+
+private:
+    Kind m_kind;
+    std::string_view m_name;
+    Setter m_set;
+    Enter m_enter;
+    GetTable m_table;
+};
+
+inline const Field *Table::begin() const { return fields; }
+inline const Field *Table::end() const { return fields + count; }
+
+namespace detail {
+
+template <typename M>
+struct member_traits;
+
+template <typename C, typename V>
+struct member_traits<V C::*> {
+    typedef C object_type;
+    typedef V value_type;
+};
+
+template <typename T>
+struct is_vector : std::false_type {};
+template <typename T, typename A>
+struct is_vector<std::vector<T, A>> : std::true_type {};
+
+template <typename T>
+struct is_optional : std::false_type {};
+template <typename T>
+struct is_optional<boost::optional<T>> : std::true_type {};
+
+// 去掉首尾空白符，数值和bool转换前调用
+std::string_view trim(std::string_view s);
+
+template <typename V>
+bool convert(std::string_view s, V &out) {
+    if constexpr (std::is_same<V, std::string>::value) {
+        out.assign(s.data(), s.size());
+        return true;
+    } else if constexpr (std::is_same<V, bool>::value) {
+        s = trim(s);
+        if (s == "true" || s == "1") {
+            out = true;
+        } else if (s == "false" || s == "0") {
+            out = false;
+        } else {
+            return false;
+        }
+        return true;
+    } else if constexpr (std::is_arithmetic<V>::value) {
+        s = trim(s);
+        // from_chars不接受前导的'+'
+        if (!s.empty() && s[0] == '+') {
+            s.remove_prefix(1);
+        }
+        auto res = std::from_chars(s.data(), s.data() + s.size(), out);
+        return res.ec == std::errc() && res.ptr == s.data() + s.size();
+    } else if constexpr (is_vector<V>::value) {
+        out.emplace_back();
+        return convert(s, out.back());
+    } else if constexpr (is_optional<V>::value) {
+        out.emplace();
+        return convert(s, *out);
+    } else {
+        static_assert(std::is_arithmetic<V>::value, "member type not supported, use child<>() for structs");
+        return false;
+    }
+}
+
+template <auto M>
+bool set(void *obj, std::string_view value) {
+    typedef typename member_traits<decltype(M)>::object_type C;
+    return convert(value, static_cast<C *>(obj)->*M);
+}
+
+template <typename V>
+struct nested {
+    typedef V type;
+    static void *enter(V &v) { return &v; }
+};
+
+template <typename V, typename A>
+struct nested<std::vector<V, A>> {
+    typedef V type;
+    static void *enter(std::vector<V, A> &v) { return &v.emplace_back(); }
+};
+
+template <typename V>
+struct nested<boost::optional<V>> {
+    typedef V type;
+    static void *enter(boost::optional<V> &v) { return &v.emplace(); }
+};
+
+template <auto M>
+void *enter(void *obj) {
+    typedef member_traits<decltype(M)> traits;
+    return nested<typename traits::value_type>::enter(static_cast<typename traits::object_type *>(obj)->*M);
+}
+
+template <typename T>
+Table table() {
+    return Table{Schema<T>::fields, std::extent<decltype(Schema<T>::fields)>::value};
+}
+
+}
+
+template <auto M>
+constexpr Field attr(std::string_view name) {
+    return Field(Field::ATTR, name, &detail::set<M>);
+}
+
+template <auto M>
+constexpr Field elem(std::string_view name) {
+    return Field(Field::ELEM, name, &detail::set<M>);
+}
+
+template <auto M>
+constexpr Field text() {
+    return Field(Field::TEXT, std::string_view(), &detail::set<M>);
+}
+
+template <auto M>
+constexpr Field child(std::string_view name) {
+    typedef typename detail::member_traits<decltype(M)>::value_type V;
+    return Field(name, &detail::enter<M>, &detail::table<typename detail::nested<V>::type>);
+}
+
+// 在Reader的事件流上找记录并逐个绑定，不依赖具体的结构体类型。
+// 推送模式的Reader遇到NEED_DATA时调用refill，由它feed()或finish()，没有refill时抛出异常
+class Binder {
+public:
+    typedef std::function<void(Reader &)> Refill;
+
+    explicit Binder(Reader &reader, Refill refill = Refill()) : m_reader(reader), m_refill(std::move(refill)) {}
+
+    // 继续往后找名为record的标签（任意深度，record为空时表示根结点），绑定到obj。
+    // 找到并绑定完返回true，文档结束返回false
+    bool next(std::string_view record, Table table, void *obj);
+
+private:
+    enum FrameKind {
+        OBJECT, // 绑定到结构体的标签
+        VALUE,  // 文本绑定到成员的标签
+        SKIP    // Schema中没有的标签
+    };
+
+    struct Frame {
+        FrameKind kind;
+        Table table;
+        void *obj;
+        const Field *field;     // VALUE：要写的字段；OBJECT：它自己的TEXT字段，没有时为空
+    };
+
+    Reader::Event pull();
+    void open(const Field *field, void *obj);
+    void set(const Field &field, void *obj, std::string_view value) const;
+
+    Reader &m_reader;
+    Refill m_refill;
+    std::vector<Frame> m_frames;
+    // 每层标签的文本，只在有字段需要时才收集，跨记录复用，不会反复分配
+    std::vector<std::string> m_texts;
+};
+
+// 对文档中每个record标签绑定出一个T，交给callback(T &&)
+template <typename T, typename Callback>
+void for_each(Reader &reader, std::string_view record, Callback &&callback, Binder::Refill refill = Binder::Refill()) {
+    Binder binder(reader, std::move(refill));
+    T item;
+    while (binder.next(record, detail::table<T>(), &item)) {
+        callback(std::move(item));
+        item = T();
+    }
+}
+
+template <typename T>
+std::vector<T> load_file(const std::string &filename, std::string_view record = std::string_view()) {
+    Reader reader(filename);
+    std::vector<T> items;
+    for_each<T>(reader, record, [&items](T &&item) { items.push_back(std::move(item)); });
+    return items;
+}
+
+// 文档分段feed()给推送模式的Reader，不会把整篇文档再拷贝一遍
+template <typename T>
+std::vector<T> load_string(std::string_view data, std::string_view record = std::string_view()) {
+    static constexpr std::size_t chunk = 16 * 1024;
+    Reader reader;
+    std::vector<T> items;
+    std::size_t pos = 0;
+    for_each<T>(reader, record, [&items](T &&item) { items.push_back(std::move(item)); },
+        [data, &pos](Reader &r) {
+            if (pos == data.size()) {
+                r.finish();
+                return;
+            }
+            std::size_t n = std::min(chunk, data.size() - pos);
+            r.feed(data.data() + pos, n);
+            pos += n;
+        });
+    return items;
+}
+
+}
+}
+
+#endif
@@ -0,0 +1,151 @@
+#include "Entity.h"
+#include "Scan.h"
+
+#include <cstdint>
+#include <algorithm>
+#include <cstring>
+
+namespace yoko {
+namespace entity {
+
+namespace {
+
+// 引用最长的是"&#x10FFFF;"和"&#1114111;"，超过这个长度的一定不合法
+const std::size_t max_ref_len = 12;
+
+// 解码p处的引用，成功时把结果写到buf中，返回解码后的长度，len为引用的长度；不合法返回0
+std::size_t decode_one(const char *p, const char *end, char *buf, std::size_t &len) {
+    const char *semi = static_cast<const char *>(std::memchr(p, ';', std::min<std::size_t>(end - p, max_ref_len)));
+    if (!semi) {
+        return 0;
+    }
+    std::string_view name(p + 1, semi - p - 1);
+    len = semi + 1 - p;
+
+    if (name.empty() || name[0] != '#') {
+        static const struct {
+            std::string_view name;
+            char c;
+        } predefined[] = {{"lt", '<'}, {"gt", '>'}, {"amp", '&'}, {"apos", '\''}, {"quot", '"'}};
+        for (const auto &e : predefined) {
+            if (name == e.name) {
+                buf[0] = e.c;
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    bool hex = name.size() > 1 && name[1] == 'x';
+    std::size_t i = hex ? 2 : 1;
+    if (i == name.size()) {
+        return 0;
+    }
+    uint32_t cp = 0;
+    for (; i < name.size(); ++i) {
+        char c = name[i];
+        uint32_t d;
+        if (c >= '0' && c <= '9') {
+            d = c - '0';
+        } else if (hex && c >= 'a' && c <= 'f') {
+            d = c - 'a' + 10;
+        } else if (hex && c >= 'A' && c <= 'F') {
+            d = c - 'A' + 10;
+        } else {
+            return 0;
+        }
+        cp = cp * (hex ? 16 : 10) + d;
+        if (cp > 0x10FFFF) {
+            return 0;
+        }
+    }
+    if (cp == 0 || (cp >= 0xD800 && cp <= 0xDFFF)) {
+        return 0;
+    }
+
+    // UTF-8编码，最长4字节，不会比引用本身长
+    if (cp < 0x80) {
+        buf[0] = cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        buf[0] = 0xC0 | (cp >> 6);
+        buf[1] = 0x80 | (cp & 0x3F);
+        return 2;
+    }
+    if (cp < 0x10000) {
+        buf[0] = 0xE0 | (cp >> 12);
+        buf[1] = 0x80 | ((cp >> 6) & 0x3F);
+        buf[2] = 0x80 | (cp & 0x3F);
+        return 3;
+    }
+    buf[0] = 0xF0 | (cp >> 18);
+    buf[1] = 0x80 | ((cp >> 12) & 0x3F);
+    buf[2] = 0x80 | ((cp >> 6) & 0x3F);
+    buf[3] = 0x80 | (cp & 0x3F);
+    return 4;
+}
+
+}
+
+const char *decode_ref(const char *p, const char *end, std::string &out) {
+    char buf[4];
+    std::size_t len;
+    std::size_t n = decode_one(p, end, buf, len);
+    if (n == 0) {
+        return nullptr;
+    }
+    out.append(buf, n);
+    return p + len;
+}
+
+std::size_t decode(std::string_view s, std::string &out) {
+    const char *p = s.data();
+    const char *e = p + s.size();
+    while (p < e) {
+        const char *amp = scan::find(p, e, '&');
+        out.append(p, amp - p);
+        if (amp == e) {
+            break;
+        }
+        p = decode_ref(amp, e, out);
+        if (!p) {
+            return amp - s.data();
+        }
+    }
+    return s.size();
+}
+
+std::size_t decode_in_place(char *p, std::size_t len) {
+    char *e = p + len;
+    char *amp = const_cast<char *>(scan::find(p, e, '&'));
+    if (amp == e) {
+        return len;
+    }
+
+    // 读的位置r总是不落后于写的位置w
+    char *w = amp;
+    const char *r = amp;
+    while (r < e) {
+        if (*r != '&') {
+            const char *next = scan::find(r, e, '&');
+            std::memmove(w, r, next - r);
+            w += next - r;
+            r = next;
+            continue;
+        }
+        char buf[4];
+        std::size_t ref_len;
+        std::size_t n = decode_one(r, e, buf, ref_len);
+        if (n == 0) {
+            return npos;
+        }
+        std::memcpy(w, buf, n);
+        w += n;
+        r += ref_len;
+    }
+    return w - p;
+}
+
+}
+}
@@ -0,0 +1,30 @@
+#ifndef __YOKO_ENTITY_H__
+#define __YOKO_ENTITY_H__
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace yoko {
+namespace entity {
+
+// 文本和属性值中的引用：五个预定义实体&lt; &gt; &amp; &apos; &quot;，
+// 以及字符引用&#123; &#x1F;（按UTF-8编码）。'&'只能用来开始一个引用，
+// 单独的'&'、不认识的实体名、格式不对或者码点不合法（0、代理区、超过0x10FFFF）的字符引用都是错误
+
+const std::size_t npos = static_cast<std::size_t>(-1);
+
+// p指向'&'，把这个引用解码后追加到out，返回引用之后的位置；不是合法的引用时返回nullptr
+const char *decode_ref(const char *p, const char *end, std::string &out);
+
+// 解码s中所有的引用，追加到out，返回处理到的位置：全部合法时为s.size()，
+// 否则为第一个不合法的引用在s中的下标，out中只有它之前的部分
+std::size_t decode(std::string_view s, std::string &out);
+
+// 原地解码[p, p + len)，解码后不会变长，返回新的长度；有不合法的引用时返回npos
+std::size_t decode_in_place(char *p, std::size_t len);
+
+}
+}
+
+#endif
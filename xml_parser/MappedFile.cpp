@@ -0,0 +1,66 @@
+#include "MappedFile.h"
+
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace yoko {
+
+MappedFile::MappedFile(MappedFile &&rhs) noexcept
+    : m_data(rhs.m_data)
+    , m_size(rhs.m_size) {
+    rhs.m_data = nullptr;
+    rhs.m_size = 0;
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&rhs) noexcept {
+    if (this != &rhs) {
+        reset();
+        std::swap(m_data, rhs.m_data);
+        std::swap(m_size, rhs.m_size);
+    }
+    return *this;
+}
+
+bool MappedFile::map(const std::string &filename, bool sequential) {
+    reset();
+    int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+
+    // 空文件不能映射，当成空的内容
+    if (st.st_size > 0) {
+        void *p = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd);
+            return false;
+        }
+        if (sequential) {
+            ::madvise(p, st.st_size, MADV_SEQUENTIAL);
+        }
+        m_data = static_cast<const char *>(p);
+        m_size = st.st_size;
+    }
+    // 映射建立之后就不再需要文件描述符了
+    ::close(fd);
+    return true;
+}
+
+void MappedFile::reset() {
+    if (m_data != nullptr) {
+        ::munmap(const_cast<char *>(m_data), m_size);
+        m_data = nullptr;
+        m_size = 0;
+    }
+}
+
+}
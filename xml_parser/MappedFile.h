@@ -0,0 +1,37 @@
+#ifndef __YOKO_MAPPED_FILE_H__
+#define __YOKO_MAPPED_FILE_H__
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace yoko {
+
+// 只读映射整个文件，析构时解除映射
+class MappedFile {
+public:
+    MappedFile() : m_data(nullptr), m_size(0) {}
+    ~MappedFile() { reset(); }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&rhs) noexcept;
+    MappedFile &operator=(MappedFile &&rhs) noexcept;
+
+    // 映射文件，打不开或者不能映射的文件（管道、字符设备等）返回false，由调用者换成普通的读取方式。
+    // sequential为true时告诉内核会顺序读，让它加大预读并及时回收读过的页
+    bool map(const std::string &filename, bool sequential = true);
+    void reset();
+
+    const char *data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+    std::string_view view() const { return std::string_view(m_data, m_size); }
+
+private:
+    const char *m_data;
+    std::size_t m_size;
+};
+
+}
+
+#endif
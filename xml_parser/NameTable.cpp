@@ -0,0 +1,34 @@
+#include <stdexcept>
+
+#include "NameTable.h"
+
+namespace yoko {
+
+uint32_t NameTable::intern(std::string_view name) {
+    auto it = m_ids.find(name);
+    if (it != m_ids.end()) {
+        return it->second;
+    }
+    if (m_strs.size() >= npos) {
+        throw std::length_error("too many names");
+    }
+    uint32_t id = m_strs.size();
+    m_strs.emplace_back(name);
+    m_ids.emplace(m_strs.back(), id);
+    return id;
+}
+
+uint32_t NameTable::find(std::string_view name) const {
+    auto it = m_ids.find(name);
+    return it != m_ids.end() ? it->second : npos;
+}
+
+std::shared_ptr<NameTable> NameTable::clone() const {
+    auto copy = std::make_shared<NameTable>();
+    for (const std::string &name : m_strs) {
+        copy->intern(name);
+    }
+    return copy;
+}
+
+}
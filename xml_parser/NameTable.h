@@ -0,0 +1,44 @@
+#ifndef __YOKO_NAME_TABLE_H__
+#define __YOKO_NAME_TABLE_H__
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace yoko {
+
+// 标签名、属性名的驻留表，同一篇文档的Node树共用一张。每个不同的名字只存一份，
+// 结点里只记录它的编号，比较名字时只比较编号。
+// 编号从0开始连续分配，只增不减；名字存放在deque中，地址不会变，str()返回的引用一直有效。
+// 和Node一样不是线程安全的：多个线程只读（包括intern()已经存在的名字）没有问题
+class NameTable {
+public:
+    static constexpr uint32_t npos = UINT32_MAX;
+
+    NameTable() = default;
+    NameTable(const NameTable &) = delete;
+    NameTable &operator=(const NameTable &) = delete;
+
+    // 返回名字的编号，不存在时先加进去
+    uint32_t intern(std::string_view name);
+    // 只查找，不存在时返回npos
+    uint32_t find(std::string_view name) const;
+    // 复制一张新表，编号不变
+    std::shared_ptr<NameTable> clone() const;
+
+    // id必须是intern()返回的，不检查npos
+    const std::string &str(uint32_t id) const { return m_strs[id]; }
+    std::size_t size() const { return m_strs.size(); }
+
+private:
+    std::deque<std::string> m_strs;
+    // key指向m_strs中的字符串
+    std::unordered_map<std::string_view, uint32_t> m_ids;
+};
+
+}
+
+#endif
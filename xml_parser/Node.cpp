@@ -1,35 +1,95 @@
 #include <stdexcept>
 
 #include "Node.h"
+#include "Writer.h"
 
 namespace yoko {
 
-boost::optional<std::string> Node::get_attr(const std::string &key) {
-    if (m_attrs.count(key)) {
-        return m_attrs[key];
+Node::Node(const Node &other) : m_names(other.m_names ? other.m_names->clone() : nullptr) {
+    copy_from(other);
+}
+
+Node &Node::operator=(const Node &other) {
+    if (this != &other) {
+        *this = Node(other);
+    }
+    return *this;
+}
+
+void Node::copy_from(const Node &other) {
+    m_name = other.m_name;
+    m_text = other.m_text;
+    m_attrs = other.m_attrs;
+    m_childs.reserve(other.m_childs.size());
+    for (const Node &child : other.m_childs) {
+        if (child.m_names == other.m_names) {
+            m_childs.emplace_back(m_names).copy_from(child);
+        } else {
+            // 从别的树加进来的子树，单独拷贝它的表
+            m_childs.push_back(child);
+        }
+    }
+}
+
+boost::optional<std::string> Node::get_attr(const std::string &key) const {
+    const std::string *v = find_attr(key);
+    if (v) {
+        return *v;
     }
     return boost::none;
 }
 
-std::string Node::to_string() {
-    std::stringstream ss;
-    ss << "<" << m_name;
+const std::string *Node::find_attr(std::string_view key) const {
+    if (!m_names || m_attrs.empty()) {
+        return nullptr;
+    }
+    return find_attr(m_names->find(key));
+}
 
-    for (const auto &attr : m_attrs) {
-        ss << " " << attr.first << "=\"" << attr.second << '"';
+const std::string *Node::find_attr(uint32_t key) const {
+    for (const Attr &attr : m_attrs) {
+        if (attr.key == key) {
+            return &attr.value;
+        }
     }
+    return nullptr;
+}
+
+Node::attrs Node::get_all_attrs() const {
+    attrs all;
+    for (const Attr &attr : m_attrs) {
+        all.emplace(m_names->str(attr.key), attr.value);
+    }
+    return all;
+}
 
-    if (m_text.empty() && m_childs.empty()) {
-        ss << "/>";
-    } else {
-        ss << ">" << m_text;
-        for (auto it = begin(); it != end(); ++it) {
-            ss << it->to_string();
+std::string &Node::operator[] (std::string_view key) {
+    uint32_t id = names().intern(key);
+    for (Attr &attr : m_attrs) {
+        if (attr.key == id) {
+            return attr.value;
         }
+    }
+    m_attrs.push_back(Attr{id, std::string()});
+    return m_attrs.back().value;
+}
 
-        ss << "</" << m_name << ">";
+NameTable &Node::names() {
+    if (!m_names) {
+        m_names = std::make_shared<NameTable>();
     }
-    return ss.str();
+    return *m_names;
 }
 
-}
\ No newline at end of file
+const std::string &Node::empty_name() {
+    static const std::string empty;
+    return empty;
+}
+
+std::string Node::to_string() const {
+    std::string out;
+    Writer(out).write(*this);
+    return out;
+}
+
+}
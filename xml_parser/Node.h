@@ -1,45 +1,93 @@
 #ifndef __YOKO_NODE_H__
 #define __YOKO_NODE_H__
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <map>
+#include <memory>
 #include <vector>
 #include <sstream>
+#include <utility>
 #include <boost/optional.hpp>
+#include <boost/container/small_vector.hpp>
+#include "NameTable.h"
 
 namespace yoko {
 
+// 标签名和属性名都驻留在NameTable中，结点只保存编号。同一棵树的结点共用一张表，
+// add_node()生成的子结点沿用父结点的表；单独构造的结点在第一次设置名字时才建表。
+// 拷贝出来的树换一张新表，和原来的树互不影响，可以分别交给不同的线程修改
 class Node {
 public:
     typedef std::vector<Node>::iterator iterator;
+    typedef std::vector<Node>::const_iterator const_iterator;
     typedef std::map<std::string, std::string> attrs;
 
-    void set_name(const std::string &name) { m_name = name; }
-    std::string get_name() const { return m_name; }
+    // 属性按出现的顺序存放，大多数标签只有一个属性，不用单独分配内存
+    struct Attr {
+        uint32_t key;
+        std::string value;
+    };
+    typedef boost::container::small_vector<Attr, 1> attr_list;
+
+    Node() = default;
+    explicit Node(std::shared_ptr<NameTable> names) : m_names(std::move(names)) {}
+    Node(const Node &other);
+    Node &operator=(const Node &other);
+    // small_vector的移动没有声明noexcept，这里声明上，vector扩容时才会移动而不是整棵树拷贝
+    Node(Node &&) noexcept = default;
+    Node &operator=(Node &&) noexcept = default;
+
+    void set_name(std::string_view name) { m_name = names().intern(name); }
+    // 还没有设置名字的结点（包括add_node()刚生成的）名字为空
+    const std::string &get_name() const {
+        return m_names && m_name != NameTable::npos ? m_names->str(m_name) : empty_name();
+    }
+    uint32_t get_name_id() const { return m_name; }
+    const std::shared_ptr<NameTable> &get_names() const { return m_names; }
 
     void set_text(const std::string &text) { m_text = text; }
-    std::string get_text() const { return m_text; }
+    void set_text(std::string &&text) { m_text = std::move(text); }
+    const std::string &get_text() const { return m_text; }
 
 
-    boost::optional<std::string> get_attr(const std::string &key);
-    attrs get_all_attrs() const { return m_attrs; }
-    std::string &operator[] (const std::string &key) { return m_attrs[key]; }
+    boost::optional<std::string> get_attr(const std::string &key) const;
+    // 不拷贝的查找，没有这个属性时返回nullptr
+    const std::string *find_attr(std::string_view key) const;
+    const std::string *find_attr(uint32_t key) const;
+    // 按名字排序的拷贝，需要遍历时用get_attr_list()更快
+    attrs get_all_attrs() const;
+    const attr_list &get_attr_list() const { return m_attrs; }
+    std::string &operator[] (std::string_view key);
 
     iterator begin() { return m_childs.begin(); }
     iterator end() { return m_childs.end(); }
+    const_iterator begin() const { return m_childs.begin(); }
+    const_iterator end() const { return m_childs.end(); }
     bool empty() const { return m_childs.empty(); }
     void add_node(const Node &node) { m_childs.push_back(node); }
+    void add_node(Node &&node) { m_childs.push_back(std::move(node)); }
+    // 在末尾追加一个空的子结点并返回它，用来原地构造子树，避免整棵子树的拷贝
+    Node &add_node() { m_childs.emplace_back(m_names); return m_childs.back(); }
+    void reserve(std::size_t n) { m_childs.reserve(n); }
 
-    std::string to_string();
+    std::string to_string() const;
     void print_format();
 
 private:
-    std::string m_name;
+    NameTable &names();
+    static const std::string &empty_name();
+    // 拷贝other的内容，和other共用表的子孙结点改用this的表
+    void copy_from(const Node &other);
+
+    std::shared_ptr<NameTable> m_names;
+    uint32_t m_name = NameTable::npos;
     std::string m_text;
-    std::map<std::string, std::string> m_attrs;
+    attr_list m_attrs;
     std::vector<Node> m_childs;
 };
 
 }
 
-#endif
\ No newline at end of file
+#endif
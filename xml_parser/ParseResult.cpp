@@ -0,0 +1,36 @@
+#include <algorithm>
+
+#include "ParseResult.h"
+
+namespace yoko {
+
+std::size_t ParseResult::line() const {
+    std::size_t end = std::min(m_offset, m_doc.size());
+    return std::count(m_doc.begin(), m_doc.begin() + end, '\n') + 1;
+}
+
+std::size_t ParseResult::column() const {
+    std::size_t end = std::min(m_offset, m_doc.size());
+    std::size_t nl = m_doc.rfind('\n', end == 0 ? 0 : end - 1);
+    if (end == 0 || nl == std::string_view::npos) {
+        return end + 1;
+    }
+    return end - nl;
+}
+
+const char *ParseResult::message() const {
+    switch (m_code) {
+    case ParseErrc::OK: return "ok";
+    case ParseErrc::INCOMPLETE: return "document incomplete";
+    case ParseErrc::FORMAT: return "format error";
+    case ParseErrc::NAME: return "parse name error";
+    case ParseErrc::ATTRIBUTE: return "parse attribution error";
+    case ParseErrc::TEXT: return "parse text error";
+    case ParseErrc::REFERENCE: return "invalid reference";
+    case ParseErrc::TOO_LARGE: return "document too large";
+    case ParseErrc::FILE_ERROR: return "file not exist";
+    }
+    return "unknown error";
+}
+
+}
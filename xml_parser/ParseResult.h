@@ -0,0 +1,48 @@
+#ifndef __YOKO_PARSE_RESULT_H__
+#define __YOKO_PARSE_RESULT_H__
+
+#include <cstddef>
+#include <string_view>
+
+namespace yoko {
+
+enum class ParseErrc {
+    OK,
+    INCOMPLETE,     // 文档在中间断掉了
+    FORMAT,         // 标签、注释或声明的格式错误
+    NAME,           // 标签名不合法
+    ATTRIBUTE,      // 属性格式错误
+    TEXT,           // 文本或结束标签错误，包括结束标签和开始标签不匹配
+    REFERENCE,      // 文本或属性值中的实体、字符引用不合法
+    TOO_LARGE,      // 文档超过4GB
+    FILE_ERROR      // 文件打不开
+};
+
+// 不抛异常的解析结果。出错时只记录错误种类和字节偏移，
+// 行号、列号在调用line()/column()时才从文档开头数出来，不出错或者不关心时没有额外开销。
+// line()/column()要用到文档缓冲区，只在产生它的Xml对象下一次load之前有效
+class ParseResult {
+public:
+    ParseResult() = default;
+    ParseResult(ParseErrc code, std::size_t offset, std::string_view doc)
+        : m_code(code), m_offset(offset), m_doc(doc) {}
+
+    bool ok() const { return m_code == ParseErrc::OK; }
+    explicit operator bool() const { return ok(); }
+
+    ParseErrc code() const { return m_code; }
+    std::size_t offset() const { return m_offset; }
+    // 从1开始计数，列号按字节计算
+    std::size_t line() const;
+    std::size_t column() const;
+    const char *message() const;
+
+private:
+    ParseErrc m_code = ParseErrc::OK;
+    std::size_t m_offset = 0;
+    std::string_view m_doc;
+};
+
+}
+
+#endif
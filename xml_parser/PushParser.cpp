@@ -0,0 +1,73 @@
+#include <stdexcept>
+
+#include "PushParser.h"
+
+namespace yoko {
+
+PushParser::PushParser(Callback callback, std::size_t depth, std::size_t buf_size)
+    : m_callback(std::move(callback))
+    , m_depth(depth)
+    , m_reader(buf_size)
+    , m_names(std::make_shared<NameTable>())
+    , m_done(false) {
+    if (depth == 0) {
+        throw std::invalid_argument("depth must be at least 1");
+    }
+}
+
+void PushParser::feed(const char *data, std::size_t len) {
+    m_reader.feed(data, len);
+    pump();
+}
+
+void PushParser::finish() {
+    m_reader.finish();
+    pump();
+}
+
+void PushParser::pump() {
+    while (!m_done) {
+        switch (m_reader.next()) {
+        case Reader::START_ELEMENT:
+            if (m_reader.depth() >= m_depth) {
+                m_nodes.emplace_back(m_names);
+                m_nodes.back().set_name(m_reader.name());
+                m_texts.emplace_back();
+            }
+            break;
+        case Reader::ATTRIBUTE:
+            if (!m_nodes.empty()) {
+                m_nodes.back()[m_reader.name()].assign(m_reader.value().data(), m_reader.value().size());
+            }
+            break;
+        case Reader::TEXT:
+            if (!m_nodes.empty()) {
+                m_texts.back().append(m_reader.value().data(), m_reader.value().size());
+            }
+            break;
+        case Reader::END_ELEMENT:
+            // END_ELEMENT之后depth()已经减一
+            if (m_reader.depth() + 1 >= m_depth) {
+                Node node = std::move(m_nodes.back());
+                node.set_text(std::move(m_texts.back()));
+                m_nodes.pop_back();
+                m_texts.pop_back();
+                if (m_nodes.empty()) {
+                    m_callback(node);
+                } else {
+                    m_nodes.back().add_node(std::move(node));
+                }
+            }
+            break;
+        case Reader::COMMENT:
+            break;
+        case Reader::END_DOCUMENT:
+            m_done = true;
+            break;
+        case Reader::NEED_DATA:
+            return;
+        }
+    }
+}
+
+}
@@ -0,0 +1,56 @@
+#ifndef __YOKO_PUSH_PARSER_H__
+#define __YOKO_PUSH_PARSER_H__
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Node.h"
+#include "Reader.h"
+
+namespace yoko {
+
+// 增量解析：数据从网络之类的地方一段段到达时，每收到一段就feed()进来，
+// 深度为depth（根结点为1）的元素一结束就生成Node交给回调，回调返回后这个Node就释放了。
+// 所以不用等整篇文档到达就能开始处理，内存中也只有未解析的数据和正在生成的那个元素。
+// 比depth浅的元素只用来检查文档格式，它们的文本、属性不会保留；
+// depth为1时回调收到的就是整棵树。
+//
+// 用法：
+//     PushParser parser([](const Node &item) { ... }, 2);
+//     while (recv(...)) { parser.feed(buf, n); }
+//     parser.finish();
+//
+// 格式错误时feed()、finish()抛出std::logic_error，之后这个对象不能再用
+class PushParser {
+public:
+    typedef std::function<void(const Node &)> Callback;
+
+    // buf_size为缓冲区大小，也是单个标签（含属性）、注释的最大长度
+    explicit PushParser(Callback callback, std::size_t depth = 2, std::size_t buf_size = 64 * 1024);
+
+    void feed(const char *data, std::size_t len);
+    void feed(const std::string &data) { feed(data.data(), data.size()); }
+    // 数据全部到达，文档不完整时抛出异常
+    void finish();
+    // 是否已经解析到文档末尾
+    bool done() const { return m_done; }
+
+private:
+    // 解析已经收到的数据，直到需要更多数据或文档结束
+    void pump();
+
+    Callback m_callback;
+    std::size_t m_depth;
+    Reader m_reader;
+    std::shared_ptr<NameTable> m_names;
+    // 正在生成的元素和它们的文本，最后一个是最内层的
+    std::vector<Node> m_nodes;
+    std::vector<std::string> m_texts;
+    bool m_done;
+};
+
+}
+
+#endif
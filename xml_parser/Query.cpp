@@ -0,0 +1,182 @@
+#include <stdexcept>
+
+#include "Query.h"
+#include "Scan.h"
+
+namespace yoko {
+
+namespace {
+
+boost::optional<std::string_view> attr_of(const Node &node, const std::string &key) {
+    const std::string *v = node.find_attr(key);
+    if (v) {
+        return std::string_view(*v);
+    }
+    return boost::none;
+}
+
+boost::optional<std::string_view> attr_of(const ViewNode &node, const std::string &key) {
+    return node.get_attr(key);
+}
+
+}
+
+Query::Query(const std::string &expr) : m_expr(expr) {
+    compile();
+}
+
+// expr := ['/' | '//'] step (('/' | '//') step)*
+// step := (name | '*') pred*
+// pred := '[' '@' name [= quoted] ']' | '[' number ']'
+void Query::compile() {
+    const std::string &s = m_expr;
+    std::size_t i = 0;
+    auto error = [&](const char *info) {
+        throw std::invalid_argument("query syntax error at " + std::to_string(i) + ", " + info + ": " + s);
+    };
+    auto skip_space = [&]() {
+        while (i < s.size() && scan::is_space(s[i])) {
+            ++i;
+        }
+    };
+    auto parse_name = [&]() {
+        std::size_t begin = i;
+        if (i < s.size() && scan::is_name_1(s[i])) {
+            i = scan::skip_name(s.data() + i, s.data() + s.size()) - s.data();
+        }
+        if (i == begin) {
+            error("expect name");
+        }
+        return s.substr(begin, i - begin);
+    };
+
+    m_absolute = !s.empty() && s[0] == '/';
+    while (true) {
+        Step step;
+        if (i < s.size() && s[i] == '/') {
+            ++i;
+            if (i < s.size() && s[i] == '/') {
+                step.descendant = true;
+                ++i;
+            }
+        } else if (i != 0) {
+            error("expect '/'");
+        }
+
+        if (i < s.size() && s[i] == '*') {
+            ++i;
+        } else {
+            step.name = parse_name();
+        }
+
+        while (i < s.size() && s[i] == '[') {
+            ++i;
+            skip_space();
+            if (i < s.size() && s[i] == '@') {
+                ++i;
+                Pred pred;
+                pred.kind = Pred::HAS_ATTR;
+                pred.key = parse_name();
+                skip_space();
+                if (i < s.size() && s[i] == '=') {
+                    ++i;
+                    skip_space();
+                    if (i == s.size() || (s[i] != '"' && s[i] != '\'')) {
+                        error("expect quoted value");
+                    }
+                    std::size_t end = s.find(s[i], i + 1);
+                    if (end == std::string::npos) {
+                        error("unterminated value");
+                    }
+                    pred.kind = Pred::ATTR_EQ;
+                    pred.value = s.substr(i + 1, end - i - 1);
+                    i = end + 1;
+                }
+                step.preds.push_back(std::move(pred));
+            } else {
+                uint32_t n = 0;
+                std::size_t begin = i;
+                while (i < s.size() && s[i] >= '0' && s[i] <= '9' && n < 100000000) {
+                    n = n * 10 + (s[i] - '0');
+                    ++i;
+                }
+                if (i == begin || n == 0 || step.index) {
+                    error("bad position");
+                }
+                step.index = n;
+            }
+            skip_space();
+            if (i == s.size() || s[i] != ']') {
+                error("expect ']'");
+            }
+            ++i;
+        }
+
+        if (m_steps.size() == max_steps) {
+            error("too many steps");
+        }
+        m_steps.push_back(std::move(step));
+        if (i == s.size()) {
+            break;
+        }
+    }
+}
+
+template <typename N, typename Out>
+bool Query::walk(const N &node, State state, Out &&out) const {
+    Counter counter;
+    counter.reset();
+    for (auto it = node.begin(); it != node.end(); ++it) {
+        const N &c = *it;
+        bool is_result;
+        State s = child(state, c.get_name(), [&c](const std::string &key) { return attr_of(c, key); },
+                        counter, is_result);
+        if (is_result && !out(c)) {
+            return false;
+        }
+        if (s && !walk(c, s, out)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 绝对路径时root是文档结点唯一的子结点，否则直接从root的子结点开始
+template <typename N, typename Out>
+void Query::run(const N &root, Out &&out) const {
+    if (!m_absolute) {
+        walk(root, initial(), out);
+        return;
+    }
+    Counter counter;
+    counter.reset();
+    bool is_result;
+    State s = child(initial(), root.get_name(), [&root](const std::string &key) { return attr_of(root, key); },
+                    counter, is_result);
+    if (is_result && !out(root)) {
+        return;
+    }
+    if (s) {
+        walk(root, s, out);
+    }
+}
+
+std::vector<const Node *> Query::select(const Node &root) const {
+    std::vector<const Node *> nodes;
+    run(root, [&nodes](const Node &node) { nodes.push_back(&node); return true; });
+    return nodes;
+}
+
+std::vector<ViewNode> Query::select(const ViewNode &root) const {
+    std::vector<ViewNode> nodes;
+    run(root, [&nodes](const ViewNode &node) { nodes.push_back(node); return true; });
+    return nodes;
+}
+
+const Node *Query::select_one(const Node &root) const {
+    const Node *found = nullptr;
+    run(root, [&found](const Node &node) { found = &node; return false; });
+    return found;
+}
+
+}
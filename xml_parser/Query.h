@@ -0,0 +1,127 @@
+#ifndef __YOKO_QUERY_H__
+#define __YOKO_QUERY_H__
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <boost/optional.hpp>
+#include "Node.h"
+#include "ViewNode.h"
+
+namespace yoko {
+
+// 简化版的XPath，表达式只编译一次，之后可以反复用来查询。支持的写法：
+//     /root/item/price        从文档开始，逐层匹配子标签
+//     //record               任意深度的record
+//     item/price             不以'/'开头时从传入的结点开始，匹配它的子标签
+//     *                      任意标签名
+//     [@id]  [@id="42"]      有某个属性、属性等于某个值，引号也可以用单引号
+//     [2]                    同一个父结点下满足标签名和属性条件的第2个，从1开始计数
+// 如/root/item[@id="42"]/price、//record[@type='a'][1]
+//
+// 匹配过程是一个状态机：每个结点的状态记录"它的子结点可以去匹配哪几步"，
+// 状态只取决于祖先结点，所以可以一边深度优先遍历一边匹配，结果天然按文档顺序且不重复；
+// 某个结点的状态为空时整棵子树都不可能匹配，直接跳过。Xml解析时过滤也是用的这个状态机
+class Query {
+public:
+    // 第i位为1表示子结点可以匹配第i步
+    typedef uint32_t State;
+    static constexpr std::size_t max_steps = 32;
+
+    // 同一个父结点下，每一步已经匹配了几个子结点，用于位置谓词
+    struct Counter {
+        uint32_t cnt[max_steps];
+        void reset() { std::fill(cnt, cnt + max_steps, 0); }
+    };
+
+    // 表达式有语法错误时抛出std::invalid_argument
+    explicit Query(const std::string &expr);
+
+    const std::string &expr() const { return m_expr; }
+
+    // 返回匹配的结点，按文档顺序，不拷贝结点。以'/'开头的表达式把root当作根结点，
+    // 否则从root的子结点开始匹配
+    std::vector<const Node *> select(const Node &root) const;
+    std::vector<ViewNode> select(const ViewNode &root) const;
+    // 第一个匹配的结点，找不到时返回空
+    const Node *select_one(const Node &root) const;
+
+    // 文档结点（根结点的父结点）的状态
+    State initial() const { return 1; }
+
+    // 由父结点的状态计算子结点的状态，counter是父结点的计数，is_result表示子结点匹配了整个表达式。
+    // get_attr(const std::string &key)返回boost::optional<std::string_view>
+    template <typename GetAttr>
+    State child(State parent, std::string_view name, GetAttr &&get_attr, Counter &counter, bool &is_result) const;
+
+private:
+    struct Pred {
+        enum Kind { HAS_ATTR, ATTR_EQ };
+        Kind kind;
+        std::string key;
+        std::string value;
+    };
+
+    struct Step {
+        bool descendant = false;    // 前面是"//"，可以跨过任意多层
+        std::string name;           // 空表示'*'
+        std::vector<Pred> preds;
+        uint32_t index = 0;         // 位置谓词，0表示没有
+    };
+
+    void compile();
+    template <typename N, typename Out>
+    void run(const N &root, Out &&out) const;
+    // out(node)返回false时停止遍历
+    template <typename N, typename Out>
+    bool walk(const N &node, State state, Out &&out) const;
+
+    std::string m_expr;
+    std::vector<Step> m_steps;
+    bool m_absolute = false;
+};
+
+template <typename GetAttr>
+Query::State Query::child(State parent, std::string_view name, GetAttr &&get_attr, Counter &counter,
+                          bool &is_result) const {
+    State state = 0;
+    is_result = false;
+    for (std::size_t i = 0; i < m_steps.size(); ++i) {
+        if (!(parent & (State(1) << i))) {
+            continue;
+        }
+        const Step &step = m_steps[i];
+        // "//"的这一步还没匹配上时，更深的结点仍然可以去匹配它
+        if (step.descendant) {
+            state |= State(1) << i;
+        }
+        if (!step.name.empty() && step.name != name) {
+            continue;
+        }
+
+        bool ok = true;
+        for (const Pred &pred : step.preds) {
+            boost::optional<std::string_view> v = get_attr(pred.key);
+            if (!v || (pred.kind == Pred::ATTR_EQ && *v != pred.value)) {
+                ok = false;
+                break;
+            }
+        }
+        if (!ok || (step.index && ++counter.cnt[i] != step.index)) {
+            continue;
+        }
+
+        if (i + 1 == m_steps.size()) {
+            is_result = true;
+        } else {
+            state |= State(1) << (i + 1);
+        }
+    }
+    return state;
+}
+
+}
+
+#endif
@@ -0,0 +1,464 @@
+#include "Reader.h"
+#include "Scan.h"
+#include "Entity.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace yoko {
+
+Reader::Reader(std::size_t buf_size)
+    : m_fd(-1)
+    , m_buf(new char[buf_size])
+    , m_cap(buf_size)
+    , m_pos(0)
+    , m_end(0)
+    , m_base(0)
+    , m_eof(false)
+    , m_pending_pos(0)
+    , m_finished(false)
+    , m_state(PROLOG)
+    , m_started(false)
+    , m_self_close(false)
+    , m_event(END_DOCUMENT)
+    , m_event_off(0)
+    , m_attr_idx(0) {
+    if (buf_size < 16) {
+        throw std::invalid_argument("buffer too small");
+    }
+}
+
+Reader::Reader(const std::string &filename, std::size_t buf_size) : Reader(buf_size) {
+    m_fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (m_fd < 0) {
+        throw std::runtime_error("file not exist");
+    }
+    int fd = m_fd;
+    m_source = [fd](char *buf, std::size_t len) -> std::size_t {
+        while (true) {
+            ssize_t n = ::read(fd, buf, len);
+            if (n >= 0) {
+                return n;
+            }
+            if (errno != EINTR) {
+                throw std::runtime_error("read file failed");
+            }
+        }
+    };
+}
+
+Reader::Reader(std::istream &is, std::size_t buf_size) : Reader(buf_size) {
+    m_source = [&is](char *buf, std::size_t len) -> std::size_t {
+        is.read(buf, len);
+        return is.gcount();
+    };
+}
+
+Reader::~Reader() {
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+}
+
+Reader::Event Reader::next() {
+    if (m_state == ATTRS) {
+        if (m_attr_idx < m_attrs.size()) {
+            m_name = m_attrs[m_attr_idx].first;
+            m_value = m_attrs[m_attr_idx].second;
+            ++m_attr_idx;
+            return m_event = ATTRIBUTE;
+        }
+        m_state = CONTENT;
+        // 单标签补一个结束事件，标签名还在缓冲区中
+        if (m_self_close) {
+            pop_name();
+            m_name = m_tag;
+            m_value = std::string_view();
+            if (m_name_ends.empty()) {
+                m_state = EPILOG;
+            }
+            return m_event = END_ELEMENT;
+        }
+    }
+    if (m_state == DONE) {
+        return m_event = END_DOCUMENT;
+    }
+
+    Event ev;
+    while (!step(ev)) {
+        // fill()会把数据移到缓冲区开头，用文档中的偏移判断有没有读到新数据
+        std::size_t end = m_base + m_end;
+        if (!fill()) {
+            error("token too large", m_buf.get() + m_pos);
+        }
+        // 推送模式下没有新数据，step()在数据不够时不会改变状态，下次可以从头再来
+        if (m_base + m_end == end && !m_eof) {
+            return m_event = NEED_DATA;
+        }
+    }
+    return m_event = ev;
+}
+
+void Reader::feed(const char *data, std::size_t len) {
+    if (m_source || m_finished) {
+        throw std::logic_error("feed() on a reader not in push mode or already finished");
+    }
+    if (m_pending_pos == m_pending.size()) {
+        m_pending.clear();
+        m_pending_pos = 0;
+    }
+    m_pending.append(data, len);
+}
+
+void Reader::finish() {
+    if (m_source) {
+        throw std::logic_error("finish() on a reader not in push mode");
+    }
+    m_finished = true;
+}
+
+bool Reader::step(Event &ev) {
+    const char *p = m_buf.get() + m_pos;
+    const char *e = m_buf.get() + m_end;
+
+    if (m_state != CONTENT) {
+        p = scan::skip_space(p, e);
+        consume(p);
+        if (p == e) {
+            if (m_eof && m_state == EPILOG) {
+                m_state = DONE;
+                m_event_off = m_base + m_pos;
+                ev = END_DOCUMENT;
+                return true;
+            }
+            return need();
+        }
+        if (*p != '<') {
+            error("format error", p);
+        }
+    } else if (p == e) {
+        return need();
+    }
+    m_event_off = m_base + m_pos;
+
+    // 文本，一直到下一个'<'，数据不够时等待更多数据，只有缓冲区满了才拆开返回
+    if (*p != '<') {
+        const char *q = scan::find(p, e, '<');
+        if (q == e && !(m_pos == 0 && m_end == m_cap)) {
+            return need();
+        }
+        // 拆开返回时不要把末尾的引用拆成两半，留到下一次
+        if (q == e) {
+            std::string_view tail(p, e - p);
+            std::size_t amp = tail.rfind('&');
+            if (amp != std::string_view::npos && amp > 0 && tail.size() - amp < 12
+                && tail.find(';', amp) == std::string_view::npos) {
+                q = p + amp;
+            }
+        }
+        m_name = std::string_view();
+        m_value = decode(p, q);
+        consume(q);
+        ev = TEXT;
+        return true;
+    }
+
+    int ret = starts_with(p, e, "<!--");
+    if (ret < 0) {
+        return need();
+    }
+    if (ret) {
+        return step_comment(p, e, ev);
+    }
+
+    if (m_state == CONTENT) {
+        ret = starts_with(p, e, "<![CDATA[");
+        if (ret < 0) {
+            return need();
+        }
+        if (ret) {
+            return step_cdata(p, e, ev);
+        }
+    }
+
+    if (m_state == PROLOG && !m_started) {
+        ret = starts_with(p, e, "<?xml");
+        if (ret < 0) {
+            return need();
+        }
+        m_started = true;
+        if (ret) {
+            if (!step_decl(p, e)) {
+                m_started = false;
+                return false;
+            }
+            return step(ev);
+        }
+    }
+
+    if (m_state == EPILOG) {
+        error("format error", p);
+    }
+
+    if (p + 1 == e) {
+        return need();
+    }
+    if (p[1] == '/') {
+        if (m_state != CONTENT) {
+            error("format error", p);
+        }
+        return step_end(p, e, ev);
+    }
+    return step_start(p, e, ev);
+}
+
+// <name k="v" ...> 或者 <name k="v" .../>
+bool Reader::step_start(const char *p, const char *e, Event &ev) {
+    const char *q = scan::skip_name(p + 1, e);
+    if (q == e) {
+        return need();
+    }
+    if (q == p + 1 || (!scan::is_space(*q) && *q != '>' && *q != '/')) {
+        error("parse name error", q);
+    }
+    std::string_view name(p + 1, q - p - 1);
+
+    m_attrs.clear();
+    while (true) {
+        q = scan::skip_space(q, e);
+        if (q == e) {
+            return need();
+        }
+        if (!scan::is_name_1(*q)) {
+            break;
+        }
+
+        const char *k = q;
+        q = scan::skip_name(q, e);
+        std::string_view key(k, q - k);
+        q = scan::skip_space(q, e);
+        if (q == e) {
+            return need();
+        }
+        if (*q != '=') {
+            error("parse attribution error", q);
+        }
+        q = scan::skip_space(q + 1, e);
+        if (q == e) {
+            return need();
+        }
+        if (*q != '"') {
+            error("parse attribution error", q);
+        }
+        const char *v = q + 1;
+        q = scan::find(v, e, '"');
+        if (q == e) {
+            return need();
+        }
+        std::string_view value(v, q - v);
+        ++q;
+
+        // 同名属性后者覆盖前者，和Xml的行为保持一致
+        auto it = m_attrs.begin();
+        while (it != m_attrs.end() && it->first != key) {
+            ++it;
+        }
+        if (it != m_attrs.end()) {
+            it->second = value;
+        } else {
+            m_attrs.emplace_back(key, value);
+        }
+    }
+
+    if (*q == '/') {
+        if (q + 1 == e) {
+            return need();
+        }
+        if (q[1] != '>') {
+            error("parse attribution error", q);
+        }
+        m_self_close = true;
+        q += 2;
+    } else if (*q == '>') {
+        m_self_close = false;
+        ++q;
+    } else {
+        error("parse attribution error", q);
+    }
+
+    // 整个标签都已经在缓冲区中，这时再原地解码，数据不够重新解析时不会解码两次
+    for (auto &attr : m_attrs) {
+        attr.second = decode(attr.second.data(), attr.second.data() + attr.second.size());
+    }
+
+    push_name(name);
+    consume(q);
+    m_tag = name;
+    m_name = name;
+    m_value = std::string_view();
+    m_attr_idx = 0;
+    m_state = ATTRS;
+    ev = START_ELEMENT;
+    return true;
+}
+
+// </name >
+bool Reader::step_end(const char *p, const char *e, Event &ev) {
+    const char *q = p + 2;
+    while (q < e && !scan::is_space(*q) && *q != '>') {
+        ++q;
+    }
+    std::string_view name(p + 2, q - p - 2);
+    q = scan::skip_space(q, e);
+    if (q == e) {
+        return need();
+    }
+    if (*q != '>' || name != top_name()) {
+        error("parse text error", p);
+    }
+
+    pop_name();
+    consume(q + 1);
+    m_name = name;
+    m_value = std::string_view();
+    m_state = m_name_ends.empty() ? EPILOG : CONTENT;
+    ev = END_ELEMENT;
+    return true;
+}
+
+// <!-- -->
+bool Reader::step_comment(const char *p, const char *e, Event &ev) {
+    std::string_view rest(p + 4, e - p - 4);
+    std::size_t idx = rest.find("--");
+    if (idx == std::string_view::npos || idx + 2 >= rest.size()) {
+        return need();
+    }
+    if (rest[idx + 2] != '>') {
+        error("format error", p + 4 + idx);
+    }
+    m_started = true;
+    m_name = std::string_view();
+    m_value = rest.substr(0, idx);
+    consume(p + 4 + idx + 3);
+    ev = COMMENT;
+    return true;
+}
+
+// <![CDATA[ ]]>，内容原样作为TEXT返回
+bool Reader::step_cdata(const char *p, const char *e, Event &ev) {
+    std::string_view rest(p + 9, e - p - 9);
+    std::size_t idx = rest.find("]]>");
+    if (idx == std::string_view::npos) {
+        return need();
+    }
+    m_name = std::string_view();
+    m_value = rest.substr(0, idx);
+    consume(p + 9 + idx + 3);
+    ev = TEXT;
+    return true;
+}
+
+// <?xml version="1.0" encoding="utf-8"?>，暂时不处理其中的内容
+bool Reader::step_decl(const char *p, const char *e) {
+    const char *q = scan::find(p + 5, e, '?');
+    if (q == e || q + 1 == e) {
+        return need();
+    }
+    if (q[1] != '>') {
+        error("format error", q);
+    }
+    consume(q + 2);
+    return true;
+}
+
+bool Reader::need() {
+    if (m_eof) {
+        error("document incomplete", m_buf.get() + m_end);
+    }
+    return false;
+}
+
+bool Reader::fill() {
+    if (m_pos > 0) {
+        std::memmove(m_buf.get(), m_buf.get() + m_pos, m_end - m_pos);
+        m_end -= m_pos;
+        m_base += m_pos;
+        m_pos = 0;
+    }
+    if (m_end == m_cap) {
+        return false;
+    }
+    std::size_t n = m_source ? m_source(m_buf.get() + m_end, m_cap - m_end) : take(m_buf.get() + m_end, m_cap - m_end);
+    // 推送模式下没有数据不代表结束，要等finish()
+    if (n == 0 && (m_source || m_finished)) {
+        m_eof = true;
+    }
+    m_end += n;
+    return true;
+}
+
+std::size_t Reader::take(char *buf, std::size_t len) {
+    std::size_t n = std::min(len, m_pending.size() - m_pending_pos);
+    std::memcpy(buf, m_pending.data() + m_pending_pos, n);
+    m_pending_pos += n;
+    // 大块数据被取走一大半之后再挪动，避免每次都移动剩下的部分
+    if (m_pending_pos == m_pending.size()) {
+        m_pending.clear();
+        m_pending_pos = 0;
+    } else if (m_pending_pos >= m_pending.size() / 2) {
+        m_pending.erase(0, m_pending_pos);
+        m_pending_pos = 0;
+    }
+    return n;
+}
+
+std::string_view Reader::decode(const char *p, const char *e) {
+    char *w = m_buf.get() + (p - m_buf.get());
+    std::size_t n = entity::decode_in_place(w, e - p);
+    if (n == entity::npos) {
+        error("invalid reference", p);
+    }
+    return std::string_view(w, n);
+}
+
+int Reader::starts_with(const char *p, const char *e, std::string_view s) const {
+    std::size_t n = std::min<std::size_t>(e - p, s.size());
+    if (s.compare(0, n, p, n) != 0) {
+        return 0;
+    }
+    if (n < s.size()) {
+        return m_eof ? 0 : -1;
+    }
+    return 1;
+}
+
+void Reader::push_name(std::string_view name) {
+    m_names.append(name.data(), name.size());
+    m_name_ends.push_back(m_names.size());
+}
+
+void Reader::pop_name() {
+    m_name_ends.pop_back();
+    m_names.resize(m_name_ends.empty() ? 0 : m_name_ends.back());
+}
+
+std::string_view Reader::top_name() const {
+    std::size_t begin = m_name_ends.size() > 1 ? m_name_ends[m_name_ends.size() - 2] : 0;
+    return std::string_view(m_names.data() + begin, m_name_ends.back() - begin);
+}
+
+void Reader::error(const char *info, const char *p) const {
+    std::size_t off = m_base + (p - m_buf.get());
+    std::string msg = "parse error at offset ";
+    msg += std::to_string(off);
+    msg += ", ";
+    msg += info;
+    msg += "\ndetail:";
+    msg.append(p, std::min<std::size_t>(m_end - (p - m_buf.get()), 60));
+    throw std::logic_error(msg);
+}
+
+}
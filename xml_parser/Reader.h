@@ -0,0 +1,141 @@
+#ifndef __YOKO_READER_H__
+#define __YOKO_READER_H__
+
+#include <cstddef>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace yoko {
+
+// 拉取式的流式解析器，文法和Xml相同，但不建树：每次next()返回一个事件。
+// 文档从一个固定大小的缓冲区中读入，读完的部分会被覆盖掉，所以不管文档多大，
+// 占用的内存只和缓冲区大小、嵌套深度有关。
+//
+// 用法：
+//     Reader reader("big.xml");
+//     for (auto ev = reader.next(); ev != Reader::END_DOCUMENT; ev = reader.next()) { ... }
+//
+// 也可以不指定数据源，由调用者用feed()把收到的数据一段段推进来（推送模式）：
+//     Reader reader;
+//     reader.feed(data, len);
+//     for (auto ev = reader.next(); ev != Reader::NEED_DATA; ev = reader.next()) { ... }
+//     ...
+//     reader.finish();    // 数据全部到达后调用，之后next()会返回END_DOCUMENT或者抛出异常
+// 数据可以在任意位置断开，包括标签、属性值和注释的中间，解析状态会保留到下一次feed()。
+//
+// 文本和属性值中的引用在缓冲区中原地解码，不另外拷贝，不合法的引用抛出异常。
+// name()/value()返回的string_view指向内部缓冲区，只在下一次调用next()之前有效
+class Reader {
+public:
+    enum Event {
+        START_ELEMENT,  // name()为标签名，之后紧跟着它的ATTRIBUTE事件
+        ATTRIBUTE,      // name()为属性名，value()为属性值
+        TEXT,           // value()为文本，被子标签或注释隔开的文本分多次返回，
+                        // 超过缓冲区大小的文本也会被拆开返回，CDATA的内容也作为TEXT返回
+        END_ELEMENT,    // name()为标签名，单标签也会有这个事件
+        COMMENT,        // value()为注释内容
+        END_DOCUMENT,
+        NEED_DATA       // 只在推送模式下出现：已有的数据解析完了，feed()之后再调用next()
+    };
+
+    // buf_size是缓冲区大小，也是单个标签（含属性）、注释、CDATA的最大长度
+    explicit Reader(const std::string &filename, std::size_t buf_size = 64 * 1024);
+    explicit Reader(std::istream &is, std::size_t buf_size = 64 * 1024);
+    // 推送模式
+    explicit Reader(std::size_t buf_size = 64 * 1024);
+    ~Reader();
+
+    Reader(const Reader &) = delete;
+    Reader &operator=(const Reader &) = delete;
+
+    Event next();
+
+    // 推送模式下追加数据，数据会被拷贝，调用之后data就可以释放了。
+    // 没有解析的数据先放在一边，next()需要时才移进缓冲区，所以随时都可以调用
+    void feed(const char *data, std::size_t len);
+    // 推送模式下表示数据已经全部到达
+    void finish();
+
+    Event event() const { return m_event; }
+    std::string_view name() const { return m_name; }
+    std::string_view value() const { return m_value; }
+    // 当前打开的标签层数，START_ELEMENT之后加一，END_ELEMENT之后减一
+    std::size_t depth() const { return m_name_ends.size(); }
+    // 当前事件在文档中的字节偏移
+    std::size_t offset() const { return m_event_off; }
+
+private:
+    enum State {
+        PROLOG,     // 根结点之前，只能有声明、注释和空白符
+        CONTENT,    // 根结点内部
+        ATTRS,      // 刚返回START_ELEMENT，正在逐个返回属性
+        EPILOG,     // 根结点结束之后，只能有注释和空白符
+        DONE
+    };
+
+    // 尝试从缓冲区中解析一个事件，数据不够时返回false
+    bool step(Event &ev);
+    bool step_start(const char *p, const char *e, Event &ev);
+    bool step_end(const char *p, const char *e, Event &ev);
+    bool step_comment(const char *p, const char *e, Event &ev);
+    bool step_cdata(const char *p, const char *e, Event &ev);
+    bool step_decl(const char *p, const char *e);
+
+    // 数据不够时调用，已经读到文件末尾时抛出异常，否则返回false
+    bool need();
+    // 把未解析的部分移到缓冲区开头，再从数据源读入，缓冲区满了返回false
+    bool fill();
+    // 推送模式下的数据源，从m_pending中取出最多len字节
+    std::size_t take(char *buf, std::size_t len);
+    // 把m_pos移动到p，之后的数据才是未解析的
+    void consume(const char *p) { m_pos = p - m_buf.get(); }
+    // 原地解码缓冲区中[p, e)的引用，返回解码后的内容；引用不合法时抛异常，错误位置为p
+    std::string_view decode(const char *p, const char *e);
+    // 检查[p, e)是否以s开头：1是，0不是，-1数据不够还不能确定
+    int starts_with(const char *p, const char *e, std::string_view s) const;
+    void push_name(std::string_view name);
+    void pop_name();
+    std::string_view top_name() const;
+    [[noreturn]] void error(const char *info, const char *p) const;
+
+    std::function<std::size_t(char *, std::size_t)> m_source;
+    int m_fd;
+
+    std::unique_ptr<char[]> m_buf;
+    std::size_t m_cap;
+    std::size_t m_pos;          // 未解析数据的开始
+    std::size_t m_end;          // 已读入数据的结尾
+    std::size_t m_base;         // m_buf[0]在文档中的偏移
+    bool m_eof;
+
+    // 推送模式下feed()进来还没移进缓冲区的数据
+    std::string m_pending;
+    std::size_t m_pending_pos;
+    bool m_finished;
+
+    State m_state;
+    bool m_started;             // 是否已经解析过内容，声明只能出现在最开始
+    bool m_self_close;          // 当前START_ELEMENT是否为单标签
+    Event m_event;
+    std::size_t m_event_off;
+    std::string_view m_name;
+    std::string_view m_value;
+
+    // 当前标签的标签名和属性，属性全部返回之后才会移动缓冲区，所以可以直接指向缓冲区
+    std::string_view m_tag;
+    std::vector<std::pair<std::string_view, std::string_view>> m_attrs;
+    std::size_t m_attr_idx;
+
+    // 打开的标签名，用来检查结束标签是否匹配
+    std::string m_names;
+    std::vector<std::size_t> m_name_ends;
+};
+
+}
+
+#endif
@@ -0,0 +1,179 @@
+#include "Scan.h"
+
+#include <atomic>
+
+// SSE2的实现没有加target("sse2")，只在编译器默认就能用SSE2时启用：x86_64总是可以，i386要加-msse2
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#include <immintrin.h>
+#define YOKO_SCAN_X86 1
+#endif
+
+namespace yoko {
+namespace scan {
+
+static constexpr CharTable make_char_table() {
+    CharTable t{};
+    for (int c = 0; c < 256; ++c) {
+        unsigned char f = 0;
+        if (c == ' ' || (c >= '\t' && c <= '\r')) {
+            f |= SPACE;
+        }
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_') {
+            f |= NAME_1 | NAME;
+        }
+        if (c >= '0' && c <= '9') {
+            f |= NAME;
+        }
+        t.v[c] = f;
+    }
+    return t;
+}
+
+const CharTable char_table = make_char_table();
+
+// ==============================逐字节实现==============================
+
+static const char *find_first_of_scalar(const char *p, const char *end, char a, char b) {
+    while (p < end && *p != a && *p != b) {
+        ++p;
+    }
+    return p;
+}
+
+static const char *skip_space_scalar(const char *p, const char *end) {
+    while (p < end && is_space(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+#ifdef YOKO_SCAN_X86
+
+// ==============================SSE2实现==============================
+
+// 每个字节是否为空白符：' '或者'\t'~'\r'（减9之后无符号小于等于4）
+static inline __m128i space_mask_sse2(__m128i v) {
+    __m128i sp = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+    __m128i x = _mm_sub_epi8(v, _mm_set1_epi8('\t'));
+    __m128i ctl = _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(4)), x);
+    return _mm_or_si128(sp, ctl);
+}
+
+static const char *find_first_of_sse2(const char *p, const char *end, char a, char b) {
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)));
+        if (mask) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 16;
+    }
+    return find_first_of_scalar(p, end, a, b);
+}
+
+static const char *skip_space_sse2(const char *p, const char *end) {
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        int mask = ~_mm_movemask_epi8(space_mask_sse2(v)) & 0xffff;
+        if (mask) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 16;
+    }
+    return skip_space_scalar(p, end);
+}
+
+// ==============================AVX2实现==============================
+
+__attribute__((target("avx2")))
+static const char *find_first_of_avx2(const char *p, const char *end, char a, char b) {
+    const __m256i va = _mm256_set1_epi8(a);
+    const __m256i vb = _mm256_set1_epi8(b);
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        unsigned mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, va), _mm256_cmpeq_epi8(v, vb)));
+        if (mask) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 32;
+    }
+    return find_first_of_sse2(p, end, a, b);
+}
+
+__attribute__((target("avx2")))
+static const char *skip_space_avx2(const char *p, const char *end) {
+    const __m256i sp = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i four = _mm256_set1_epi8(4);
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        __m256i x = _mm256_sub_epi8(v, tab);
+        __m256i is_sp = _mm256_or_si256(_mm256_cmpeq_epi8(v, sp),
+                                        _mm256_cmpeq_epi8(_mm256_min_epu8(x, four), x));
+        unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(is_sp));
+        if (mask) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 32;
+    }
+    return skip_space_sse2(p, end);
+}
+
+#endif
+
+// ==============================运行时分派==============================
+
+typedef const char *(*find_first_of_fn)(const char *, const char *, char, char);
+typedef const char *(*skip_space_fn)(const char *, const char *);
+
+static const char *find_first_of_resolve(const char *p, const char *end, char a, char b);
+static const char *skip_space_resolve(const char *p, const char *end);
+
+// 初始值是常量初始化，保证在其他全局对象的构造函数里调用也没问题；
+// 多个线程可能同时第一次调用，所以用atomic，写入的值都一样，relaxed就够了
+static std::atomic<find_first_of_fn> find_first_of_impl(find_first_of_resolve);
+static std::atomic<skip_space_fn> skip_space_impl(skip_space_resolve);
+
+static void resolve() {
+#ifdef YOKO_SCAN_X86
+    // 可能在其他全局对象的构造函数里第一次调用，这时libgcc还没有检测CPU，先自己初始化
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        find_first_of_impl.store(find_first_of_avx2, std::memory_order_relaxed);
+        skip_space_impl.store(skip_space_avx2, std::memory_order_relaxed);
+    } else {
+        find_first_of_impl.store(find_first_of_sse2, std::memory_order_relaxed);
+        skip_space_impl.store(skip_space_sse2, std::memory_order_relaxed);
+    }
+#else
+    find_first_of_impl.store(find_first_of_scalar, std::memory_order_relaxed);
+    skip_space_impl.store(skip_space_scalar, std::memory_order_relaxed);
+#endif
+}
+
+static const char *find_first_of_resolve(const char *p, const char *end, char a, char b) {
+    resolve();
+    return find_first_of(p, end, a, b);
+}
+
+static const char *skip_space_resolve(const char *p, const char *end) {
+    resolve();
+    return skip_space_impl.load(std::memory_order_relaxed)(p, end);
+}
+
+const char *find_first_of(const char *p, const char *end, char a, char b) {
+    return find_first_of_impl.load(std::memory_order_relaxed)(p, end, a, b);
+}
+
+const char *skip_space(const char *p, const char *end) {
+    // 大多数情况下当前字符就不是空白符，不用进入向量化的循环
+    if (p < end && !is_space(*p)) {
+        return p;
+    }
+    return skip_space_impl.load(std::memory_order_relaxed)(p, end);
+}
+
+}
+}
@@ -0,0 +1,51 @@
+#ifndef __YOKO_SCAN_H__
+#define __YOKO_SCAN_H__
+
+#include <cstring>
+
+namespace yoko {
+namespace scan {
+
+// 分词时几个最热的扫描循环。x86-64上有SSE2/AVX2两套实现，
+// 第一次调用时按CPU支持情况选择，其他平台走逐字节的实现。
+// 所有函数都在[p, end)范围内扫描，找不到时返回end
+
+// 字符分类表，按unsigned char下标
+enum {
+    SPACE = 1,      // 空白符，和"C" locale下的isspace一致
+    NAME_1 = 2,     // 名字首字符：字母、下划线
+    NAME = 4        // 名字字符：字母、数字、下划线
+};
+struct CharTable {
+    unsigned char v[256];
+};
+extern const CharTable char_table;
+
+inline bool is_space(char c) { return char_table.v[static_cast<unsigned char>(c)] & SPACE; }
+inline bool is_name_1(char c) { return char_table.v[static_cast<unsigned char>(c)] & NAME_1; }
+inline bool is_name(char c) { return char_table.v[static_cast<unsigned char>(c)] & NAME; }
+
+// 第一个等于a或者b的字符
+const char *find_first_of(const char *p, const char *end, char a, char b);
+
+// 第一个不是空白符的字符
+const char *skip_space(const char *p, const char *end);
+
+// 第一个等于c的字符，glibc的memchr已经是向量化的，直接用
+inline const char *find(const char *p, const char *end, char c) {
+    const void *r = std::memchr(p, c, end - p);
+    return r ? static_cast<const char *>(r) : end;
+}
+
+// 第一个不是名字字符的字符，名字一般很短，查表比向量化更划算
+inline const char *skip_name(const char *p, const char *end) {
+    while (p < end && is_name(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+}
+}
+
+#endif
@@ -0,0 +1,220 @@
+#include "Snapshot.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace yoko {
+namespace snapshot {
+
+namespace {
+
+const char magic[8] = {'Y', 'O', 'K', 'O', 'S', 'N', 'A', 'P'};
+const uint32_t version = 1;
+const uint32_t byte_order = 0x01020304;
+
+std::size_t align8(std::size_t n) {
+    return (n + 7) & ~std::size_t(7);
+}
+
+// 先在内存中把树展开成结点表，再一次写出去
+class Builder {
+public:
+    template <typename N> void build(const N &root) {
+        add(root);
+        if (m_pool.size() >= ViewTable::npos || m_nodes.size() >= ViewTable::npos) {
+            throw std::length_error("document too large");
+        }
+    }
+
+    void write(const std::string &filename) const;
+
+private:
+    ViewTable::Span intern(std::string_view name) {
+        auto it = m_names.find(name);
+        if (it != m_names.end()) {
+            return it->second;
+        }
+        ViewTable::Span s = add_str(name);
+        m_names.emplace(name, s);
+        return s;
+    }
+
+    ViewTable::Span add_str(std::string_view str) {
+        ViewTable::Span s{static_cast<uint32_t>(m_pool.size()), static_cast<uint32_t>(str.size())};
+        m_pool.append(str.data(), str.size());
+        return s;
+    }
+
+    void add_attrs(const Node &node) {
+        for (const Node::Attr &attr : node.get_attr_list()) {
+            m_attrs.push_back(ViewTable::Attr{intern(node.get_names()->str(attr.key)), add_str(attr.value)});
+        }
+    }
+
+    void add_attrs(const ViewNode &node) {
+        for (const auto &attr : node.get_all_attrs()) {
+            m_attrs.push_back(ViewTable::Attr{intern(attr.first), add_str(attr.second)});
+        }
+    }
+
+    // 先序遍历，返回结点的下标
+    template <typename N> uint32_t add(const N &node) {
+        uint32_t idx = m_nodes.size();
+        m_nodes.push_back(ViewTable::Rec{intern(node.get_name()), add_str(node.get_text()),
+                                         static_cast<uint32_t>(m_attrs.size()), 0,
+                                         ViewTable::npos, ViewTable::npos});
+        add_attrs(node);
+        m_nodes[idx].attr_cnt = m_attrs.size() - m_nodes[idx].first_attr;
+
+        uint32_t last = ViewTable::npos;
+        for (auto it = node.begin(); it != node.end(); ++it) {
+            uint32_t child = add(*it);
+            if (last == ViewTable::npos) {
+                m_nodes[idx].first_child = child;
+            } else {
+                m_nodes[last].next_sibling = child;
+            }
+            last = child;
+        }
+        return idx;
+    }
+
+    std::string m_pool;
+    // key指向被保存的树中的名字，保存的过程中一直有效
+    std::unordered_map<std::string_view, ViewTable::Span> m_names;
+    std::vector<ViewTable::Rec> m_nodes;
+    std::vector<ViewTable::Attr> m_attrs;
+};
+
+void write_all(int fd, const void *data, std::size_t len) {
+    const char *p = static_cast<const char *>(data);
+    while (len > 0) {
+        ssize_t n = ::write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("write file failed");
+        }
+        p += n;
+        len -= n;
+    }
+}
+
+void Builder::write(const std::string &filename) const {
+    Header header;
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.byte_order = byte_order;
+    header.pool_size = m_pool.size();
+    header.node_count = m_nodes.size();
+    header.attr_count = m_attrs.size();
+
+    int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("open file failed");
+    }
+    try {
+        static const char zeros[8] = {0};
+        write_all(fd, &header, sizeof(header));
+        write_all(fd, m_pool.data(), m_pool.size());
+        write_all(fd, zeros, align8(sizeof(header) + m_pool.size()) - sizeof(header) - m_pool.size());
+        write_all(fd, m_nodes.data(), m_nodes.size() * sizeof(ViewTable::Rec));
+        write_all(fd, m_attrs.data(), m_attrs.size() * sizeof(ViewTable::Attr));
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    if (::close(fd) < 0) {
+        throw std::runtime_error("write file failed");
+    }
+}
+
+bool check_span(ViewTable::Span span, uint64_t pool_size) {
+    return uint64_t(span.off) + span.len <= pool_size;
+}
+
+// 快照可能被截断或者改坏，映射时把所有的偏移和下标检查一遍，之后访问时就不用再检查。
+// save()按先序给结点编号，子结点和后面的兄弟结点编号都更大；
+// 除根结点外每个结点只被引用一次，这样结点之间不会有环，遍历一定能结束
+bool check_tables(const Header &header, const ViewTable::Rec *nodes, const ViewTable::Attr *attrs) {
+    for (uint64_t i = 0; i < header.attr_count; ++i) {
+        if (!check_span(attrs[i].key, header.pool_size) || !check_span(attrs[i].value, header.pool_size)) {
+            return false;
+        }
+    }
+    std::vector<bool> referenced(header.node_count);
+    auto link = [&](uint64_t from, uint32_t to) {
+        if (to == ViewTable::npos) {
+            return true;
+        }
+        if (to <= from || to >= header.node_count || referenced[to]) {
+            return false;
+        }
+        referenced[to] = true;
+        return true;
+    };
+    for (uint64_t i = 0; i < header.node_count; ++i) {
+        const ViewTable::Rec &rec = nodes[i];
+        if (!check_span(rec.name, header.pool_size) || !check_span(rec.text, header.pool_size)
+            || uint64_t(rec.first_attr) + rec.attr_cnt > header.attr_count
+            || !link(i, rec.first_child) || !link(i, rec.next_sibling)) {
+            return false;
+        }
+    }
+    return nodes[0].next_sibling == ViewTable::npos;
+}
+
+}
+
+void save(const Node &root, const std::string &filename) {
+    Builder builder;
+    builder.build(root);
+    builder.write(filename);
+}
+
+void save(const ViewNode &root, const std::string &filename) {
+    Builder builder;
+    builder.build(root);
+    builder.write(filename);
+}
+
+bool attach(std::string_view data, ViewTable &tab) {
+    Header header;
+    if (data.size() < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != version
+        || header.byte_order != byte_order || header.node_count == 0 || header.pool_size >= ViewTable::npos
+        || header.node_count >= ViewTable::npos || header.attr_count >= ViewTable::npos) {
+        return false;
+    }
+    std::size_t nodes_off = align8(sizeof(header) + header.pool_size);
+    std::size_t attrs_off = nodes_off + header.node_count * sizeof(ViewTable::Rec);
+    if (data.size() != attrs_off + header.attr_count * sizeof(ViewTable::Attr)) {
+        return false;
+    }
+
+    const ViewTable::Rec *nodes = reinterpret_cast<const ViewTable::Rec *>(data.data() + nodes_off);
+    const ViewTable::Attr *attrs = reinterpret_cast<const ViewTable::Attr *>(data.data() + attrs_off);
+    if (!check_tables(header, nodes, attrs)) {
+        return false;
+    }
+
+    tab.clear();
+    tab.buf = data.substr(sizeof(header), header.pool_size);
+    tab.mapped_nodes = nodes;
+    tab.mapped_attrs = attrs;
+    tab.mapped_node_cnt = header.node_count;
+    tab.mapped_attr_cnt = header.attr_count;
+    return true;
+}
+
+}
+}
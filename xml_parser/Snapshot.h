@@ -0,0 +1,40 @@
+#ifndef __YOKO_SNAPSHOT_H__
+#define __YOKO_SNAPSHOT_H__
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "Node.h"
+#include "ViewNode.h"
+
+namespace yoko {
+namespace snapshot {
+
+// 解析好的树的二进制快照，可以直接映射到内存中使用，不用再解析：
+//     Header
+//     字符串池    所有的名字、文本和属性值，名字只存一份
+//     填充到8字节对齐
+//     ViewTable::Rec[node_count]     结点表，0号为根结点，偏移都相对字符串池
+//     ViewTable::Attr[attr_count]    属性表
+// 按本机字节序保存，换了字节序或者版本的快照会被拒绝。
+// 加载时检查头部、各部分的大小以及结点表中所有的偏移和下标，损坏的快照会被拒绝，不会越界访问
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t pool_size;
+    uint64_t node_count;
+    uint64_t attr_count;
+};
+
+// 把以root为根的树写到文件中，出错时抛出std::runtime_error
+void save(const Node &root, const std::string &filename);
+void save(const ViewNode &root, const std::string &filename);
+
+// data为映射好的快照文件，检查通过后让tab直接指向其中的结点表和字符串池，格式不对或者内容损坏时返回false
+bool attach(std::string_view data, ViewTable &tab);
+
+}
+}
+
+#endif
@@ -0,0 +1,43 @@
+#include <stdexcept>
+
+#include "ViewNode.h"
+#include "Writer.h"
+
+namespace yoko {
+
+ViewTable::Span ViewTable::append(std::string_view text) {
+    if (buf.size() + extra.size() + text.size() > npos) {
+        throw std::length_error("document too large");
+    }
+    Span span{static_cast<uint32_t>(buf.size() + extra.size()), static_cast<uint32_t>(text.size())};
+    extra.append(text.data(), text.size());
+    return span;
+}
+
+void ViewTable::clear() {
+    buf = std::string_view();
+    std::string().swap(extra);
+    std::vector<Rec>().swap(nodes);
+    std::vector<Attr>().swap(attrs);
+    mapped_nodes = nullptr;
+    mapped_attrs = nullptr;
+    mapped_node_cnt = 0;
+    mapped_attr_cnt = 0;
+}
+
+boost::optional<std::string_view> ViewNode::get_attr(std::string_view key) const {
+    for (const auto &attr : get_all_attrs()) {
+        if (attr.first == key) {
+            return attr.second;
+        }
+    }
+    return boost::none;
+}
+
+std::string ViewNode::to_string() const {
+    std::string out;
+    Writer(out).write(*this);
+    return out;
+}
+
+}
@@ -0,0 +1,166 @@
+#ifndef __YOKO_VIEW_NODE_H__
+#define __YOKO_VIEW_NODE_H__
+
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <boost/optional.hpp>
+
+namespace yoko {
+
+// 整篇文档的结点表，所有结点平铺在nodes里，用first_child/next_sibling下标串成树，
+// 每个结点的属性连续存放在attrs里。解析时只往数组末尾追加，遍历时内存连续，
+// 销毁时也只是释放几块连续内存，不用递归析构。
+// 名字、文本都只记录偏移和长度：偏移小于buf.size()时指向文档缓冲区，
+// 否则指向extra（被子标签隔开、需要拼接的文本）。
+// 从快照加载时结点和属性不在nodes/attrs中，而是直接指向映射的文件，见mapped_nodes/mapped_attrs；
+// 所以读取时都要通过node()/attr()
+struct ViewTable {
+    static constexpr uint32_t npos = UINT32_MAX;
+
+    struct Span {
+        uint32_t off;
+        uint32_t len;
+    };
+
+    struct Attr {
+        Span key;
+        Span value;
+    };
+
+    struct Rec {
+        Span name;
+        Span text;
+        uint32_t first_attr;
+        uint32_t attr_cnt;
+        uint32_t first_child;
+        uint32_t next_sibling;
+    };
+
+    std::string_view str(Span s) const {
+        if (s.off < buf.size()) {
+            return std::string_view(buf.data() + s.off, s.len);
+        }
+        return std::string_view(extra.data() + (s.off - buf.size()), s.len);
+    }
+
+    const Rec &node(uint32_t i) const { return mapped_nodes ? mapped_nodes[i] : nodes[i]; }
+    const Attr &attr(uint32_t i) const { return mapped_attrs ? mapped_attrs[i] : attrs[i]; }
+    std::size_t node_count() const { return mapped_nodes ? mapped_node_cnt : nodes.size(); }
+    std::size_t attr_count() const { return mapped_attrs ? mapped_attr_cnt : attrs.size(); }
+
+    // 把text追加到extra中，返回它的Span
+    Span append(std::string_view text);
+
+    void clear();
+
+    std::string_view buf;
+    std::string extra;
+    std::vector<Rec> nodes;
+    std::vector<Attr> attrs;
+
+    // 快照中的结点和属性，不为空时代替nodes和attrs
+    const Rec *mapped_nodes = nullptr;
+    const Attr *mapped_attrs = nullptr;
+    std::size_t mapped_node_cnt = 0;
+    std::size_t mapped_attr_cnt = 0;
+};
+
+// VIEW模式下的结点，只是结点表上的一个下标，拷贝代价很小。
+// 名字、属性和文本都是指向文档缓冲区的string_view，不拷贝任何字符，
+// 缓冲区和结点表由Xml对象持有，Xml销毁或重新load之后结点失效
+class ViewNode {
+public:
+    class iterator;
+
+    // 遍历属性，解引用得到(key, value)
+    class attr_iterator {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef std::pair<std::string_view, std::string_view> value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef void pointer;
+        typedef value_type reference;
+
+        attr_iterator(const ViewTable *tab, uint32_t idx) : m_tab(tab), m_idx(idx) {}
+
+        value_type operator*() const {
+            const ViewTable::Attr &attr = m_tab->attr(m_idx);
+            return value_type(m_tab->str(attr.key), m_tab->str(attr.value));
+        }
+        attr_iterator &operator++() { ++m_idx; return *this; }
+        attr_iterator operator++(int) { attr_iterator old = *this; ++m_idx; return old; }
+        bool operator==(const attr_iterator &rhs) const { return m_idx == rhs.m_idx; }
+        bool operator!=(const attr_iterator &rhs) const { return m_idx != rhs.m_idx; }
+
+    private:
+        const ViewTable *m_tab;
+        uint32_t m_idx;
+    };
+
+    struct attrs {
+        attr_iterator b;
+        attr_iterator e;
+        attr_iterator begin() const { return b; }
+        attr_iterator end() const { return e; }
+    };
+
+    ViewNode() : m_tab(nullptr), m_idx(ViewTable::npos) {}
+    ViewNode(const ViewTable *tab, uint32_t idx) : m_tab(tab), m_idx(idx) {}
+
+    std::string_view get_name() const { return m_tab->str(rec().name); }
+    std::string_view get_text() const { return m_tab->str(rec().text); }
+
+    boost::optional<std::string_view> get_attr(std::string_view key) const;
+    attrs get_all_attrs() const {
+        return attrs{attr_iterator(m_tab, rec().first_attr),
+                     attr_iterator(m_tab, rec().first_attr + rec().attr_cnt)};
+    }
+
+    iterator begin() const;
+    iterator end() const;
+    bool empty() const { return rec().first_child == ViewTable::npos; }
+
+    std::string to_string() const;
+
+private:
+    const ViewTable::Rec &rec() const { return m_tab->node(m_idx); }
+
+    const ViewTable *m_tab;
+    uint32_t m_idx;
+};
+
+// 遍历子结点，沿着next_sibling往后走
+class ViewNode::iterator {
+public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef ViewNode value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const ViewNode *pointer;
+    typedef const ViewNode &reference;
+
+    iterator(const ViewTable *tab, uint32_t idx) : m_node(tab, idx) {}
+
+    reference operator*() const { return m_node; }
+    pointer operator->() const { return &m_node; }
+    iterator &operator++() {
+        m_node.m_idx = m_node.m_tab->node(m_node.m_idx).next_sibling;
+        return *this;
+    }
+    iterator operator++(int) { iterator old = *this; ++*this; return old; }
+    bool operator==(const iterator &rhs) const { return m_node.m_idx == rhs.m_node.m_idx; }
+    bool operator!=(const iterator &rhs) const { return m_node.m_idx != rhs.m_node.m_idx; }
+
+private:
+    ViewNode m_node;
+};
+
+inline ViewNode::iterator ViewNode::begin() const { return iterator(m_tab, rec().first_child); }
+inline ViewNode::iterator ViewNode::end() const { return iterator(m_tab, ViewTable::npos); }
+
+}
+
+#endif
@@ -0,0 +1,189 @@
+#include "Writer.h"
+#include "Scan.h"
+
+#include <cerrno>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace yoko {
+
+namespace {
+
+void for_each_attr(const Node &node, const std::function<void(std::string_view, std::string_view)> &f) {
+    for (const Node::Attr &attr : node.get_attr_list()) {
+        f(node.get_names()->str(attr.key), attr.value);
+    }
+}
+
+void for_each_attr(const ViewNode &node, const std::function<void(std::string_view, std::string_view)> &f) {
+    for (const auto &attr : node.get_all_attrs()) {
+        f(attr.first, attr.second);
+    }
+}
+
+}
+
+Writer::Writer(std::string &out, Style style) : m_out(&out), m_style(style) {}
+
+Writer::Writer(int fd, Style style)
+    : Writer([fd](const char *data, std::size_t len) {
+          while (len > 0) {
+              ssize_t n = ::write(fd, data, len);
+              if (n < 0) {
+                  if (errno == EINTR) {
+                      continue;
+                  }
+                  throw std::runtime_error("write file failed");
+              }
+              data += n;
+              len -= n;
+          }
+      }, style) {}
+
+Writer::Writer(std::FILE *fp, Style style)
+    : Writer([fp](const char *data, std::size_t len) {
+          if (std::fwrite(data, 1, len, fp) != len) {
+              throw std::runtime_error("write file failed");
+          }
+      }, style) {}
+
+Writer::Writer(Sink sink, Style style) : m_out(&m_buf), m_sink(std::move(sink)), m_style(style) {
+    m_buf.reserve(flush_size + flush_size / 4);
+}
+
+Writer::~Writer() {
+    try {
+        flush();
+    } catch (...) {
+    }
+}
+
+void Writer::write(const Node &node) {
+    write_node(node, 0);
+    check();
+}
+
+void Writer::write(const ViewNode &node) {
+    write_node(node, 0);
+    check();
+}
+
+void Writer::flush() {
+    if (!m_sink || m_buf.empty()) {
+        return;
+    }
+    // sink抛异常时也清空，析构时不会把同一段内容再写一次
+    try {
+        m_sink(m_buf.data(), m_buf.size());
+    } catch (...) {
+        m_buf.clear();
+        throw;
+    }
+    m_buf.clear();
+}
+
+template <typename N>
+void Writer::write_node(const N &node, int level) {
+    bool pretty = m_style == PRETTY;
+    std::string_view name = node.get_name();
+    std::string_view text = node.get_text();
+    bool has_text = pretty ? !blank(text) : !text.empty();
+
+    if (pretty) {
+        put_indent(level);
+    }
+    put('<');
+    put(name);
+    for_each_attr(node, [this](std::string_view key, std::string_view value) {
+        put(' ');
+        put(key);
+        put("=\"");
+        put_escaped(value, true);
+        put('"');
+    });
+
+    if (!has_text && node.empty()) {
+        put(pretty ? "/>\n" : "/>");
+        return;
+    }
+    put('>');
+    if (pretty && !node.empty()) {
+        put('\n');
+        if (has_text) {
+            put_indent(level + 1);
+            put_text(text);
+            put('\n');
+        }
+        for (auto it = node.begin(); it != node.end(); ++it) {
+            write_node(*it, level + 1);
+            check();
+        }
+        put_indent(level);
+    } else {
+        put_text(text);
+        for (auto it = node.begin(); it != node.end(); ++it) {
+            write_node(*it, level + 1);
+            check();
+        }
+    }
+    put("</");
+    put(name);
+    put(pretty ? ">\n" : ">");
+}
+
+void Writer::put_escaped(std::string_view s, bool in_attr) {
+    const char *p = s.data();
+    const char *e = p + s.size();
+    const char *run = p;
+    for (; p < e; ++p) {
+        const char *rep;
+        switch (*p) {
+        case '<': rep = "&lt;"; break;
+        case '>': rep = "&gt;"; break;
+        case '"':
+            if (!in_attr) {
+                continue;
+            }
+            rep = "&quot;";
+            break;
+        case '&': rep = "&amp;"; break;
+        default:
+            continue;
+        }
+        m_out->append(run, p - run);
+        m_out->append(rep);
+        run = p + 1;
+    }
+    m_out->append(run, e - run);
+}
+
+void Writer::put_text(std::string_view text) {
+    if (m_style == COMPACT) {
+        put_escaped(text, false);
+        return;
+    }
+
+    // 去掉前后空白符，连续空白符替换成一个' '，每一段非空白的内容整段转义
+    const char *p = scan::skip_space(text.data(), text.data() + text.size());
+    const char *e = text.data() + text.size();
+    bool first = true;
+    while (p < e) {
+        const char *q = p;
+        while (q < e && !scan::is_space(*q)) {
+            ++q;
+        }
+        if (!first) {
+            put(' ');
+        }
+        put_escaped(std::string_view(p, q - p), false);
+        first = false;
+        p = scan::skip_space(q, e);
+    }
+}
+
+bool Writer::blank(std::string_view text) const {
+    const char *e = text.data() + text.size();
+    return scan::skip_space(text.data(), e) == e;
+}
+
+}
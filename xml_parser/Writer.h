@@ -0,0 +1,68 @@
+#ifndef __YOKO_WRITER_H__
+#define __YOKO_WRITER_H__
+
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <string_view>
+#include "Node.h"
+#include "ViewNode.h"
+
+namespace yoko {
+
+// 把Node或ViewNode树写成xml文本，整棵树只遍历一遍，所有输出都追加到同一个缓冲区中。
+// 输出到字符串时直接追加到调用者的字符串后面；输出到fd、FILE*或回调时，
+// 缓冲区超过flush_size就交给sink写出去，析构时写出剩下的部分。
+//
+// COMPACT: 原样输出文本，不加任何空白符
+// PRETTY:  每个标签一行，按层缩进4个空格，文本去掉前后空白符并把连续空白符换成一个' '
+//
+// 文本中的'&'、'<'、'>'和属性值中的'"'会被转义，解析时解码过的内容写出去之后还能原样读回来
+class Writer {
+public:
+    enum Style { COMPACT, PRETTY };
+
+    // 写出[data, data + len)，出错时抛出异常
+    typedef std::function<void(const char *, std::size_t)> Sink;
+
+    static constexpr std::size_t flush_size = 64 * 1024;
+
+    explicit Writer(std::string &out, Style style = COMPACT);
+    explicit Writer(int fd, Style style = COMPACT);
+    explicit Writer(std::FILE *fp, Style style = COMPACT);
+    explicit Writer(Sink sink, Style style = COMPACT);
+    // 析构时写出缓冲区中剩下的内容，这时的错误会被忽略，需要知道结果时先调用flush()
+    ~Writer();
+
+    Writer(const Writer &) = delete;
+    Writer &operator=(const Writer &) = delete;
+
+    void write(const Node &node);
+    void write(const ViewNode &node);
+    void flush();
+
+private:
+    template <typename N> void write_node(const N &node, int level);
+    void put(std::string_view s) { m_out->append(s.data(), s.size()); }
+    void put(char c) { m_out->push_back(c); }
+    void put_indent(int level) { m_out->append(4 * level, ' '); }
+    void put_escaped(std::string_view s, bool in_attr);
+    void put_text(std::string_view text);
+    // PRETTY模式下文本去掉前后空白符之后是否为空
+    bool blank(std::string_view text) const;
+    void check() {
+        if (m_sink && m_out->size() >= flush_size) {
+            flush();
+        }
+    }
+
+    std::string *m_out;
+    std::string m_buf;
+    Sink m_sink;
+    Style m_style;
+};
+
+}
+
+#endif
@@ -1,52 +1,266 @@
 #include "Xml.h"
+#include "Scan.h"
+#include "Writer.h"
+#include "Entity.h"
 
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
 #include <fstream>
 #include <iostream>
+#include <thread>
 
 static const int detail_len = 60;
 
-#define THROW_ERROR(error_info, error_detail) \
-    do{ \
-    std::string info = "parse error in "; \
-    std::string file_pos = __FILE__; \
-    file_pos.append(":"); \
-    file_pos.append(std::to_string(__LINE__)); \
-    info += file_pos; \
-    info += ", "; \
-    info += (error_info); \
-    info += "\ndetail:"; \
-    info += (error_detail); \
-    throw std::logic_error(info); \
-}while(false)
+// 文档小于这个大小时并行解析得不偿失，直接串行解析
+static const std::size_t parallel_min_len = 1 << 20;
+
+// 并行解析时每个线程分到的块数，块多一些各线程的负载更均衡
+static const std::size_t parallel_chunks_per_thread = 4;
 
 namespace yoko {
 
-void Xml::loadFile(const std::string &filename) {
+// 结构扫描时遇到的标签种类
+enum Markup {
+    MARKUP_COMMENT,
+    MARKUP_CDATA,
+    MARKUP_START,
+    MARKUP_EMPTY,   // 单标签
+    MARKUP_END
+};
+
+// 结构扫描，p指向'<'：跳过一个注释、开始标签或结束标签，返回它后面的位置，kind为标签的种类。
+// 只找边界不检查格式，数据不完整时返回nullptr
+static const char *skip_markup(const char *p, const char *e, Markup &kind) {
+    if (e - p < 2) {
+        return nullptr;
+    }
+
+    // CDATA，其中可以有'<'，一直跳到"]]>"
+    static const char cdata[] = "<![CDATA[";
+    if (p[1] == '!' && e - p >= 9 && std::equal(cdata, cdata + 9, p)) {
+        static const char close[] = "]]>";
+        const char *q = std::search(p + 9, e, close, close + 3);
+        if (q == e) {
+            return nullptr;
+        }
+        kind = MARKUP_CDATA;
+        return q + 3;
+    }
+
+    // 注释，文法要求注释中第一个"--"就是结束
+    if (p[1] == '!') {
+        static const char dash[] = "--";
+        const char *q = std::search(std::min(p + 4, e), e, dash, dash + 2);
+        if (e - q < 3) {
+            return nullptr;
+        }
+        kind = MARKUP_COMMENT;
+        return q + 3;
+    }
+
+    // 结束标签
+    if (p[1] == '/') {
+        const char *q = scan::find(p, e, '>');
+        if (q == e) {
+            return nullptr;
+        }
+        kind = MARKUP_END;
+        return q + 1;
+    }
+
+    // 开始标签，属性值中可能有'>'，要跳过引号中的内容
+    const char *q = p + 1;
+    while (true) {
+        q = scan::find_first_of(q, e, '>', '"');
+        if (q == e) {
+            return nullptr;
+        }
+        if (*q == '>') {
+            break;
+        }
+        q = scan::find(q + 1, e, '"');
+        if (q == e) {
+            return nullptr;
+        }
+        ++q;
+    }
+    kind = q[-1] == '/' ? MARKUP_EMPTY : MARKUP_START;
+    return q + 1;
+}
+
+void Xml::loadFile(const std::string &filename, Mode mode) {
+    raise(tryLoadFile(filename, mode));
+}
+
+void Xml::loadString(const std::string &str, Mode mode) {
+    raise(tryLoadString(str, mode));
+}
+
+void Xml::loadString(std::string &&str, Mode mode) {
+    raise(tryLoadString(std::move(str), mode));
+}
+
+ParseResult Xml::tryLoadFile(const std::string &filename, Mode mode) {
+    // 直接在映射的页面上解析，不拷贝到堆上；管道之类不能映射的文件还是读到m_str中
+    if (m_map.map(filename)) {
+        std::string().swap(m_str);
+        m_buf = m_map.view();
+        return load(mode);
+    }
+
     std::ifstream ifs(filename);
     if (!ifs) {
+        m_map.reset();
+        std::string().swap(m_str);
+        m_buf = std::string_view();
+        // 和解析出错一样，上一篇文档的结点都丢掉，根结点为空结点
+        reset(mode);
+        m_view.buf = m_buf;
+        add_empty_root();
+        m_err = ParseResult(ParseErrc::FILE_ERROR, 0, m_buf);
+        return m_err;
+    }
+    return tryLoadString(std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>()), mode);
+}
+
+ParseResult Xml::tryLoadString(const std::string &str, Mode mode) {
+    return tryLoadString(std::string(str), mode);
+}
+
+ParseResult Xml::tryLoadString(std::string &&str, Mode mode) {
+    m_map.reset();
+    m_str = std::move(str);
+    m_buf = m_str;
+    return load(mode);
+}
+
+void Xml::saveSnapshot(const std::string &filename) const {
+    if (m_mode == Mode::VIEW) {
+        snapshot::save(get_view_root(), filename);
+    } else {
+        snapshot::save(m_root, filename);
+    }
+}
+
+void Xml::loadSnapshot(const std::string &filename, Mode mode) {
+    reset(mode);
+    std::string().swap(m_str);
+    m_buf = std::string_view();
+    // VIEW模式下按结点随机访问，不需要顺序预读
+    if (!m_map.map(filename, false)) {
+        add_empty_root();
         throw std::runtime_error("file not exist");
     }
-    m_str = std::move(std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>()));
+    if (!snapshot::attach(m_map.view(), m_view)) {
+        m_map.reset();
+        add_empty_root();
+        throw std::runtime_error("bad snapshot");
+    }
+    m_buf = m_view.buf;
     m_idx = 0;
-    trim();
-    m_len = m_str.size();
-    parse();
+    m_len = m_buf.size();
+
+    if (m_mode == Mode::COPY) {
+        m_root = Node(intern_names());
+        build_node(m_root, 0, m_len >= parallel_min_len ? threads() : 1);
+        m_view.clear();
+        m_buf = std::string_view();
+        m_map.reset();
+    }
 }
 
-void Xml::loadString(const std::string &str) {
-    m_str = str;
+// 把错误转成异常，异常的类型和信息格式都和以前一样
+void Xml::raise(const ParseResult &result) {
+    switch (result.code()) {
+    case ParseErrc::OK:
+        return;
+    case ParseErrc::FILE_ERROR:
+        throw std::runtime_error("file not exist");
+    case ParseErrc::TOO_LARGE:
+        throw std::length_error("document too large");
+    default:
+        break;
+    }
+    std::string info = "parse error at offset ";
+    info += std::to_string(result.offset());
+    info += ", ";
+    info += result.message();
+    info += "\ndetail:";
+    info += m_buf.substr(std::min(result.offset(), m_buf.size()), detail_len);
+    throw std::logic_error(info);
+}
+
+bool Xml::fail(ParseErrc code) {
+    if (m_err.ok()) {
+        m_err = ParseResult(code, m_idx, m_buf);
+    }
+    return false;
+}
+
+void Xml::reset(Mode mode) {
+    m_mode = mode;
+    m_root = Node();
+    m_view.clear();
+    m_err = ParseResult();
+}
+
+void Xml::add_empty_root() {
+    m_view.nodes.push_back(ViewTable::Rec{ViewTable::Span{0, 0}, ViewTable::Span{0, 0},
+                                          0, 0, ViewTable::npos, ViewTable::npos});
+}
+
+ParseResult Xml::load(Mode mode) {
+    reset(mode);
     trim();
     m_idx = 0;
-    m_len = m_str.size();
-    parse();
+    m_len = m_buf.size();
+    // 结点表中用32位的偏移
+    if (m_len >= ViewTable::npos) {
+        fail(ParseErrc::TOO_LARGE);
+        add_empty_root();
+        return m_err;
+    }
+    m_view.buf = m_buf;
+    // 出错时丢掉解析了一半的结点表，根结点为空结点；文档缓冲区保留，ParseResult::line()/column()还要用到它
+    bool ok = parse();
+    if (!ok) {
+        m_view.clear();
+        m_view.buf = m_buf;
+    }
+    // 没有根结点时和原来一样得到一个空结点
+    if (m_view.nodes.empty()) {
+        add_empty_root();
+    }
+
+    // COPY模式下Node树保存了自己的拷贝，结点表和文档缓冲区都不再需要
+    if (ok && m_mode == Mode::COPY) {
+        m_root = Node(intern_names());
+        build_node(m_root, 0, m_len >= parallel_min_len ? threads() : 1);
+        m_view.clear();
+        m_buf = std::string_view();
+        m_map.reset();
+        std::string().swap(m_str);
+    }
+    return m_err;
 }
 
-void Xml::parse() {
-    get_c();
+bool Xml::parse() {
+    if (!get_c()) {
+        return fail(ParseErrc::INCOMPLETE);
+    }
 
     // 声明只会在文档开头，且就一个
-    if (m_str.compare(m_idx, 5, "<?xml") == 0) {
-        parse_decl();
+    if (m_buf.compare(m_idx, 5, "<?xml") == 0 && !parse_decl()) {
+        return false;
+    }
+
+    // 文档结点的过滤状态，根结点是它唯一的子结点
+    Query::Counter counter;
+    Filter doc{0, true, nullptr};
+    if (m_filter) {
+        counter.reset();
+        doc = Filter{m_filter->initial(), false, &counter};
     }
 
     // 根结点只有一个,用flag标记
@@ -54,116 +268,171 @@ void Xml::parse() {
     while (m_idx < m_len) {
         get_c();
         // 解析注释
-        if (!m_str.compare(m_idx, 4, "<!--")) {
-            parse_comment();
+        if (!m_buf.compare(m_idx, 4, "<!--")) {
+            if (!parse_comment()) {
+                return false;
+            }
             continue;
         }
 
         // 解析根结点
-        if (flag && m_idx + 1 < m_len && m_str[m_idx + 1]) {
-            m_root = parse_node();
+        if (flag && m_idx + 1 < m_len && m_buf[m_idx + 1]) {
+            uint32_t root;
+            bool ok = !m_filter && threads() > 1 && m_len - m_idx >= parallel_min_len
+                      ? parse_root_parallel() : parse_node(doc, root);
+            if (!ok) {
+                return false;
+            }
             flag = false;
             continue;
         }
 
-        // 其他不符合情况就抛异常
-        THROW_ERROR("format error", m_str.substr(m_idx, detail_len));
+        // 其他不符合的情况都是格式错误
+        return fail(ParseErrc::FORMAT);
     }
+    return true;
 }
 
 // <?xml version="1.0" encoding="utf-8"?>
-void Xml::parse_decl() { 
+bool Xml::parse_decl() { 
     m_idx += 5;
     // 暂时不处理
-    while (m_idx < m_str.size() && m_str[m_idx] != '?') {
+    while (m_idx < m_buf.size() && m_buf[m_idx] != '?') {
         ++m_idx;
     }
 
-    if (m_idx + 1 >= m_str.size() || m_str[m_idx + 1] != '>') {
-        THROW_ERROR("format error", m_str.substr(m_idx, detail_len));
+    if (m_idx + 1 >= m_buf.size() || m_buf[m_idx + 1] != '>') {
+        return fail(ParseErrc::FORMAT);
     }
     m_idx += 2;
+    return true;
 }
 
 // <!-- -->
-void Xml::parse_comment() {
+bool Xml::parse_comment() {
     m_idx += 4;
-    std::string comment;
-    std::size_t next_idx = m_str.find("--", m_idx);
+    std::string_view comment;
+    std::size_t next_idx = m_buf.find("--", m_idx);
     if (next_idx != std::string::npos) {;
-        if (next_idx + 2 < m_str.size() && m_str[next_idx + 2] == '>') {
-            comment = m_str.substr(m_idx, next_idx - m_idx);
+        if (next_idx + 2 < m_buf.size() && m_buf[next_idx + 2] == '>') {
+            comment = m_buf.substr(m_idx, next_idx - m_idx);
             m_idx = next_idx + 3;
             // 将注释加入结点。。。
-            return;
+            return true;
         }
     }
 
-    THROW_ERROR("format error", m_str.substr(m_idx, detail_len));
+    return fail(ParseErrc::FORMAT);
+}
+
+// <![CDATA[ ]]>，内容原样作为文本，不解码
+bool Xml::parse_cdata(Text &text) {
+    m_idx += 9;
+    std::size_t end = m_buf.find("]]>", m_idx);
+    if (end == std::string_view::npos) {
+        return fail(ParseErrc::FORMAT);
+    }
+    text.add(m_buf, span(m_idx, end));
+    m_idx = end + 3;
+    return true;
+}
+
+bool Xml::parse_node(Filter parent, uint32_t &idx) {
+    std::size_t extra_size = m_view.extra.size();
+    bool has_content;
+    if (!parse_open(idx, has_content)) {
+        return false;
+    }
+
+    Filter filter = parent;
+    if (!parent.inside) {
+        ViewNode node(&m_view, idx);
+        filter.state = m_filter->child(parent.state, node.get_name(),
+                                       [&node](const std::string &key) { return node.get_attr(key); },
+                                       *parent.counter, filter.inside);
+        // 子树中不可能有匹配的结点，只找到结束标签，不建结点
+        if (!filter.inside && !filter.state) {
+            if (has_content && (!skip_content() || !parse_close(idx, Text()))) {
+                return fail(ParseErrc::TEXT);
+            }
+            drop(idx, extra_size);
+            idx = ViewTable::npos;
+            return true;
+        }
+    }
+
+    // 解析文本（其中会包含子标签、文本和注释）
+    if (has_content && !parse_text(idx, filter)) {
+        return fail(ParseErrc::TEXT);
+    }
+
+    // 自己不匹配，子树中也没有留下匹配的结点
+    if (!filter.inside && m_view.nodes[idx].first_child == ViewTable::npos) {
+        drop(idx, extra_size);
+        idx = ViewTable::npos;
+    }
+    return true;
 }
 
-Node Xml::parse_node() {
-    Node node;
+// 解析开始标签，追加到结点表中，has_content在单标签时为false，否则为true且m_idx位于'>'的下一个位置
+bool Xml::parse_open(uint32_t &idx, bool &has_content) {
     char ch = get_c();
     if (ch != '<') {
-        THROW_ERROR("format error", m_str.substr(m_idx, detail_len));
+        return fail(ParseErrc::FORMAT);
     }
     ++m_idx;
+
+    idx = m_view.nodes.size();
+    m_view.nodes.push_back(ViewTable::Rec{ViewTable::Span{0, 0}, ViewTable::Span{0, 0},
+                                          static_cast<uint32_t>(m_view.attrs.size()), 0,
+                                          ViewTable::npos, ViewTable::npos});
+
     // 解析标签名字，成功时m_idx停留在空白符、'/'或者'>'上
-    int ret = parse_name(node);
-    if (!ret) {
-        THROW_ERROR("parse name error", m_str.substr(m_idx, detail_len));
+    if (!parse_name(idx)) {
+        return fail(ParseErrc::NAME);
     }
     
     // 解析标签名字，成功时m_idx停留在'/'或者'>'上
-    ret = parse_attr(node);
-    if (!ret) {
-        THROW_ERROR("parse attribution error", m_str.substr(m_idx, detail_len));
+    if (!parse_attr(idx)) {
+        return fail(ParseErrc::ATTRIBUTE);
     }
 
     // 说明不包含文本和子标签
-    if (!m_str.compare(m_idx, 2, "/>")) {
+    if (!m_buf.compare(m_idx, 2, "/>")) {
         m_idx += 2;
-        return node;
+        has_content = false;
+        return true;
     }
     
-    // 解析文本（其中会包含子标签、文本和注释）
-    if (m_str[m_idx] == '>') {
+    if (m_buf[m_idx] == '>') {
         ++m_idx;
-        ret = parse_text(node);
-        if (ret) {
-            return node;
-        }
+        has_content = true;
+        return true;
     }
-    THROW_ERROR("parse text error", m_str.substr(m_idx, detail_len));
+    return fail(ParseErrc::TEXT);
 }
 
 // 解析完标签名，m_idx处在空白字符、'/'或者'>'上，其他情况都返回false
-bool Xml::parse_name(Node &node) {
-    std::string name;
-    while (m_idx < m_len && chk_c(m_str[m_idx])) {
-        name.push_back(m_str[m_idx]);
-        ++m_idx;
-    }
+bool Xml::parse_name(uint32_t idx) {
+    std::size_t begin = m_idx;
+    seek(scan::skip_name(cur(), last()));
 
     // m_idx超过字符串大小或者当前的字符不为空白字符、'/'和'>'
-    if (m_idx >= m_len || (!isspace(m_str[m_idx]) && m_str[m_idx] != '>' && m_str[m_idx] != '/')) {
+    if (m_idx >= m_len || (!scan::is_space(m_buf[m_idx]) && m_buf[m_idx] != '>' && m_buf[m_idx] != '/')) {
         return false;
     }
-    node.set_name(name);
+    m_view.nodes[idx].name = span(begin, m_idx);
     return true;
 }
 
 // 解析完属性，m_idx位于在'/'或者'>'时返回true，其他情况返回false
-bool Xml::parse_attr(Node &node) {
+bool Xml::parse_attr(uint32_t idx) {
+    ViewTable::Rec &rec = m_view.nodes[idx];
     char ch = get_c();
     while (chk_1_c(ch)) {
-        std::string k, v;
-
-        while (m_idx < m_str.size() && chk_c(m_str[m_idx])) {
-            k.push_back(m_str[m_idx]);
-            ++m_idx;
-        }
+        std::size_t k_begin = m_idx;
+        seek(scan::skip_name(cur(), last()));
+        ViewTable::Span k = span(k_begin, m_idx);
 
         if (get_c() != '=') {
             return false;
@@ -175,18 +444,45 @@ bool Xml::parse_attr(Node &node) {
         }
         m_idx++;
 
-        while (m_idx < m_str.size() && m_str[m_idx] != '"') {
-            v.push_back(m_str[m_idx]);
-            ++m_idx;
-        }
+        std::size_t v_begin = m_idx;
+        seek(scan::find(cur(), last(), '"'));
 
         if (m_idx >= m_len) {
             return false;
         }
 
+        // 有引用时解码到extra中，没有时直接指向m_buf
+        ViewTable::Span v = span(v_begin, m_idx);
+        if (scan::find(m_buf.data() + v_begin, cur(), '&') != cur()) {
+            std::string decoded;
+            std::size_t n = entity::decode(m_view.str(v), decoded);
+            if (n != v.len) {
+                m_idx = v_begin + n;
+                return fail(ParseErrc::REFERENCE);
+            }
+            if (decoded.size() != v.len) {
+                if (m_buf.size() + m_view.extra.size() + decoded.size() > ViewTable::npos) {
+                    return fail(ParseErrc::TOO_LARGE);
+                }
+                v = m_view.append(decoded);
+            }
+        }
+
+        // 同名属性后者覆盖前者，当前结点的属性都在attrs的末尾
+        std::string_view key = m_view.str(k);
+        uint32_t i = rec.first_attr;
+        while (i < m_view.attrs.size() && m_view.str(m_view.attrs[i].key) != key) {
+            ++i;
+        }
+        if (i < m_view.attrs.size()) {
+            m_view.attrs[i].value = v;
+        } else {
+            m_view.attrs.push_back(ViewTable::Attr{k, v});
+            ++rec.attr_cnt;
+        }
+
         // 过滤掉引号
         ++m_idx;
-        node[k] = v;
         ch = get_c();
     }
 
@@ -197,131 +493,458 @@ bool Xml::parse_attr(Node &node) {
 }
 
 // 解析文本, m_idx位于字符'>'的下一个位置true，否则返回false
-bool Xml::parse_text(Node &node) {
-    std::string text;
+bool Xml::parse_text(uint32_t idx, Filter filter) {
+    Text text;
+    uint32_t last_child = ViewTable::npos;
+    return parse_content(idx, text, last_child, false, filter) && parse_close(idx, text);
+}
+
+// 解析标签的内容，直到遇到结束标签的"</"，to_end为true时解析到m_len为止（并行解析时用）
+bool Xml::parse_content(uint32_t idx, Text &text, uint32_t &last_child, bool to_end, Filter filter) {
+    Query::Counter counter;
+    if (!filter.inside) {
+        counter.reset();
+        filter.counter = &counter;
+    }
+
     while (m_idx < m_len) {
-        while (m_idx < m_len && m_str[m_idx] != '<') {
-            text.push_back(m_str[m_idx]);
-            ++m_idx;
+        // 文本一直到下一个'<'，其中的引用解码后单独追加，没有引用的文本仍然直接指向m_buf
+        std::size_t begin = m_idx;
+        const char *p = cur();
+        while (true) {
+            p = scan::find_first_of(p, last(), '<', '&');
+            if (p == last() || *p == '<') {
+                break;
+            }
+            std::string ref;
+            const char *q = entity::decode_ref(p, last(), ref);
+            if (!q) {
+                seek(p);
+                return fail(ParseErrc::REFERENCE);
+            }
+            text.add(m_buf, span(begin, p - m_buf.data()));
+            text.add_decoded(m_buf, ref);
+            p = q;
+            begin = p - m_buf.data();
+        }
+        seek(p);
+        text.add(m_buf, span(begin, m_idx));
+        if (to_end && m_idx >= m_len) {
+            return true;
         }
         
-        // 根据是结束标签、注释或子标签分情况处理
-        if (!m_str.compare(m_idx, 2, "</")) {
-            m_idx += 2;
-            std::string name;
-            
-            // 这里不需要检查标签名是否合法，因为最后都是要和相对应标签的合法名字比较
-            while (m_idx < m_len && !isspace(m_str[m_idx]) && m_str[m_idx] != '>') {
-                name.push_back(m_str[m_idx]);
-                ++m_idx;
+        // 根据是结束标签、注释、CDATA或子标签分情况处理
+        if (!m_buf.compare(m_idx, 2, "</")) {
+            return true;
+        } else if (!m_buf.compare(m_idx, 4, "<!--")) {
+            if (!parse_comment()) {
+                return false;
             }
-            char ch = get_c();
-            if (ch == '>' && !name.compare(node.get_name())) {
-                node.set_text(text);
-                ++m_idx;
-                return true;
+        } else if (!m_buf.compare(m_idx, 9, "<![CDATA[")) {
+            if (!parse_cdata(text)) {
+                return false;
             }
-            return false;
-        } else if (!m_str.compare(m_idx, 4, "<!--")) {
-            parse_comment();
         } else {
-            // 添加子标签结点，解析失败parse_node()会抛异常
-            node.add_node(parse_node());
+            // 子标签直接追加到结点表末尾，再挂到兄弟链表上
+            uint32_t child;
+            if (!parse_node(filter, child)) {
+                return false;
+            }
+            if (child == ViewTable::npos) {
+                continue;
+            }
+            if (last_child == ViewTable::npos) {
+                m_view.nodes[idx].first_child = child;
+            } else {
+                m_view.nodes[last_child].next_sibling = child;
+            }
+            last_child = child;
         }
     }
+    // 数据用完了还没遇到结束标签，由parse_close()报错
+    return true;
+}
+
+// 解析结束标签，成功时m_idx位于字符'>'的下一个位置
+bool Xml::parse_close(uint32_t idx, const Text &text) {
     // 正常结束循环只能说字符串不够解析了，返回false
+    if (m_buf.compare(m_idx, 2, "</")) {
+        return false;
+    }
+    std::size_t begin = m_idx;
+    m_idx += 2;
+    std::size_t name_begin = m_idx;
+    
+    // 这里不需要检查标签名是否合法，因为最后都是要和相对应标签的合法名字比较
+    while (m_idx < m_len && !scan::is_space(m_buf[m_idx]) && m_buf[m_idx] != '>') {
+        ++m_idx;
+    }
+    std::string_view name(m_buf.data() + name_begin, m_idx - name_begin);
+    char ch = get_c();
+    if (ch == '>' && name == m_view.str(m_view.nodes[idx].name)) {
+        if (text.is_joined && m_buf.size() + m_view.extra.size() + text.joined.size() > ViewTable::npos) {
+            return fail(ParseErrc::TOO_LARGE);
+        }
+        m_view.nodes[idx].text = text.is_joined ? m_view.append(text.joined) : text.span;
+        ++m_idx;
+        return true;
+    }
+    // 标签名不匹配时错误位置指向结束标签的开头
+    m_idx = begin;
     return false;
 }
 
-void Xml::trim() {
-    int i = m_str.size() - 1;
-    while (i >= 0 && isspace(m_str[i])) {
-        --i;
+bool Xml::skip_content() {
+    const char *p = cur();
+    const char *e = last();
+    std::size_t depth = 0;
+    while (true) {
+        p = scan::find(p, e, '<');
+        Markup kind;
+        const char *q = skip_markup(p, e, kind);
+        if (!q) {
+            seek(p);
+            return fail(ParseErrc::INCOMPLETE);
+        }
+        if (kind == MARKUP_END) {
+            if (depth == 0) {
+                seek(p);
+                return true;
+            }
+            --depth;
+        } else if (kind == MARKUP_START) {
+            ++depth;
+        }
+        p = q;
     }
-    m_str.resize(i + 1);
 }
 
-bool Xml::chk_1_c(char c) const {
-    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c== '_') {
-        return true;
+void Xml::drop(uint32_t idx, std::size_t extra_size) {
+    m_view.attrs.resize(m_view.nodes[idx].first_attr);
+    m_view.nodes.resize(idx);
+    m_view.extra.resize(extra_size);
+}
+
+void Xml::Text::add(std::string_view buf, ViewTable::Span s) {
+    if (s.len == 0) {
+        return;
     }
-    return false;
+    if (!is_joined && span.len == 0) {
+        span = s;
+        return;
+    }
+    if (!is_joined) {
+        joined.assign(buf.data() + span.off, span.len);
+        is_joined = true;
+    }
+    joined.append(buf.data() + s.off, s.len);
 }
 
-bool Xml::chk_c(char c) const {
-    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_') {
-        return true;
+void Xml::Text::add_decoded(std::string_view buf, std::string_view s) {
+    if (!is_joined) {
+        joined.assign(buf.data() + span.off, span.len);
+        is_joined = true;
     }
-    return false;
+    joined.append(s.data(), s.size());
 }
 
-char Xml::get_c() {
-    while (m_idx < m_len && isspace(m_str[m_idx])) {
-        ++m_idx;
+void Xml::Text::add(std::string_view buf, const Text &other) {
+    if (!other.is_joined) {
+        add(buf, other.span);
+        return;
     }
-    if (m_idx >= m_len) {
-        THROW_ERROR("document incomplete", m_str.substr(m_idx, detail_len));
+    if (!is_joined) {
+        joined.assign(buf.data() + span.off, span.len);
+        is_joined = true;
     }
-    return m_str[m_idx];
+    joined += other.joined;
 }
 
-std::string Xml::purify_text(const std::string &text) {
-    std::string pt;
-    int l = 0, r = text.size() - 1;
-    while (l <= r && isspace(text[l])) {
-        l++;
+unsigned Xml::threads() const {
+    if (m_threads == 0) {
+        return std::max(1u, std::thread::hardware_concurrency());
     }
+    return m_threads;
+}
 
-    while (l <= r && isspace(text[r])) {
-        r--;
+// 并行解析根结点：
+// 1. 串行解析根结点的开始标签；
+// 2. 预扫描根结点的内容，在顶层子标签的开始处切成若干块；
+// 3. 每块由一个独立的Xml对象用parse_content()解析到它自己的结点表中，多个线程并行处理；
+// 4. 把各块的结点表按文档顺序拼到m_view后面，子标签挂到根结点下，再串行检查根结点的结束标签。
+// 任何一块解析失败时退回串行解析，这样报出的错误和串行时完全一样
+bool Xml::parse_root_parallel() {
+    std::size_t root_begin = m_idx;
+    uint32_t root;
+    bool has_content;
+    if (!parse_open(root, has_content)) {
+        return false;
+    }
+    if (!has_content) {
+        return true;
     }
 
-    bool flag = true;
-    while (l <= r) {
-        if (!isspace(text[l])) {
-            pt.push_back(text[l]);
-            flag = true;
-        } else if (flag) {
-            pt.push_back(' ');
-            flag = false;
+    unsigned nthreads = threads();
+    std::size_t root_end;
+    std::vector<std::size_t> splits = split_root(nthreads * parallel_chunks_per_thread, root_end);
+    if (splits.empty()) {
+        m_view.clear();
+        m_view.buf = m_buf;
+        m_idx = root_begin;
+        return parse_node(Filter{0, true, nullptr}, root);
+    }
+
+    // 每块的解析器共用文档缓冲区，结点表中的偏移都是相对整个文档的，拼接时不用改；
+    // 0号结点是虚拟的父结点，它的子结点就是这一块里的顶层子标签
+    std::size_t nchunks = splits.size();
+    std::vector<Xml> chunks(nchunks);
+    std::vector<Text> texts(nchunks);
+    std::vector<uint32_t> lasts(nchunks, ViewTable::npos);
+    std::vector<char> failed(nchunks, false);
+    std::atomic<std::size_t> next_chunk(0);
+
+    auto run = [&]() {
+        std::size_t i;
+        while ((i = next_chunk.fetch_add(1)) < nchunks) {
+            Xml &chunk = chunks[i];
+            chunk.m_buf = m_buf;
+            chunk.m_idx = splits[i];
+            chunk.m_len = i + 1 < nchunks ? splits[i + 1] : root_end;
+            chunk.m_view.buf = m_buf;
+            chunk.m_view.nodes.push_back(ViewTable::Rec{ViewTable::Span{0, 0}, ViewTable::Span{0, 0},
+                                                        0, 0, ViewTable::npos, ViewTable::npos});
+            failed[i] = !chunk.parse_content(0, texts[i], lasts[i], true, Filter{0, true, nullptr})
+                        || chunk.m_idx != chunk.m_len;
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < nthreads; ++i) {
+        workers.emplace_back(run);
+    }
+    run();
+    for (auto &t : workers) {
+        t.join();
+    }
+
+    if (std::find(failed.begin(), failed.end(), true) != failed.end()) {
+        m_view.clear();
+        m_view.buf = m_buf;
+        m_idx = root_begin;
+        return parse_node(Filter{0, true, nullptr}, root);
+    }
+
+    // 先算出每块的结点、属性和extra拼接到m_view后的位置，再并行地搬过去
+    std::vector<uint32_t> node_base(nchunks), attr_base(nchunks), extra_base(nchunks);
+    std::size_t nodes = m_view.nodes.size(), attrs = m_view.attrs.size(), extra = m_view.extra.size();
+    for (std::size_t i = 0; i < nchunks; ++i) {
+        node_base[i] = nodes - 1;   // 跳过虚拟的0号结点
+        attr_base[i] = attrs;
+        extra_base[i] = extra;
+        nodes += chunks[i].m_view.nodes.size() - 1;
+        attrs += chunks[i].m_view.attrs.size();
+        extra += chunks[i].m_view.extra.size();
+    }
+    if (m_buf.size() + extra >= ViewTable::npos || nodes >= ViewTable::npos) {
+        return fail(ParseErrc::TOO_LARGE);
+    }
+    m_view.nodes.resize(nodes);
+    m_view.attrs.resize(attrs);
+    m_view.extra.resize(extra);
+
+    next_chunk = 0;
+    auto move = [&]() {
+        std::size_t i;
+        while ((i = next_chunk.fetch_add(1)) < nchunks) {
+            const ViewTable &from = chunks[i].m_view;
+            uint32_t nb = node_base[i];
+            uint32_t ab = attr_base[i];
+            uint32_t eb = extra_base[i];
+            auto fix = [&](ViewTable::Span s) {
+                if (s.off >= m_buf.size()) {
+                    s.off += eb;
+                }
+                return s;
+            };
+            for (std::size_t j = 1; j < from.nodes.size(); ++j) {
+                ViewTable::Rec rec = from.nodes[j];
+                rec.name = fix(rec.name);
+                rec.text = fix(rec.text);
+                rec.first_attr += ab;
+                if (rec.first_child != ViewTable::npos) {
+                    rec.first_child += nb;
+                }
+                if (rec.next_sibling != ViewTable::npos) {
+                    rec.next_sibling += nb;
+                }
+                m_view.nodes[nb + j] = rec;
+            }
+            for (std::size_t j = 0; j < from.attrs.size(); ++j) {
+                m_view.attrs[ab + j] = ViewTable::Attr{fix(from.attrs[j].key), fix(from.attrs[j].value)};
+            }
+            std::copy(from.extra.begin(), from.extra.end(), m_view.extra.begin() + eb);
+        }
+    };
+    workers.clear();
+    for (unsigned i = 1; i < nthreads && i < nchunks; ++i) {
+        workers.emplace_back(move);
+    }
+    move();
+    for (auto &t : workers) {
+        t.join();
+    }
+
+    // 按文档顺序把每块的顶层子标签串到根结点下，文本也按顺序拼起来
+    Text text;
+    uint32_t last_child = ViewTable::npos;
+    for (std::size_t i = 0; i < nchunks; ++i) {
+        text.add(m_buf, texts[i]);
+        uint32_t first = chunks[i].m_view.nodes[0].first_child;
+        if (first == ViewTable::npos) {
+            continue;
         }
-        ++l;
+        first += node_base[i];
+        if (last_child == ViewTable::npos) {
+            m_view.nodes[root].first_child = first;
+        } else {
+            m_view.nodes[last_child].next_sibling = first;
+        }
+        last_child = lasts[i] + node_base[i];
+    }
+
+    m_idx = root_end;
+    if (!parse_close(root, text)) {
+        return fail(ParseErrc::TEXT);
     }
-    return pt;
+    return true;
 }
 
-void Xml::print() {
-    std::cout << print(m_root, 0);
-}
-
-std::string Xml::print(Node &node, int level) {
-    std::string text = purify_text(node.get_text());
-    std::stringstream ss;
-    int cnt = 4 * level;
-    ss << std::string(cnt, ' ') << "<" << node.get_name();
-    Node::attrs atts = node.get_all_attrs();
-    for (const auto &it : atts) {
-        ss << " " << it.first << "=\"" << it.second << '"';
-    }
-    if (text.empty() && node.empty()) {
-        ss << "/>\n";
-    } else if (node.empty()) {
-        ss << ">" << text << "</" << node.get_name() << ">\n";
-    } else if (text.empty()) {
-        ss << ">" <<"\n";
-        for (auto it = node.begin(); it != node.end(); ++it) {
-            ss << print(*it, level + 1);
+// 从m_idx（根结点开始标签之后）扫描到根结点的结束标签，在顶层子标签的开始处切成大约parts块，
+// 返回每块的开始位置，root_end为根结点结束标签的位置。
+// 这里只找标签的边界，不检查格式，格式错误留给各块解析时发现；找不到根结点的结束标签时返回空
+std::vector<std::size_t> Xml::split_root(std::size_t parts, std::size_t &root_end) const {
+    std::vector<std::size_t> splits{m_idx};
+    std::size_t step = std::max<std::size_t>((m_len - m_idx) / parts, 1);
+    std::size_t next = m_idx + step;
+    const char *p = cur();
+    const char *e = last();
+    std::size_t depth = 0;
+    while (true) {
+        p = scan::find(p, e, '<');
+        Markup kind;
+        const char *q = skip_markup(p, e, kind);
+        if (!q) {
+            return {};
         }
-        ss << std::string(cnt, ' ') << "</" << node.get_name() << ">\n";
-    } else {
-        ss << ">" <<"\n" << std::string(4 + cnt, ' ') << text << "\n";
-        for (auto it = node.begin(); it != node.end(); ++it) {
-            ss << print(*it, level + 1);
+        if (kind == MARKUP_END) {
+            if (depth == 0) {
+                root_end = p - m_buf.data();
+                return splits;
+            }
+            --depth;
+        } else if (kind == MARKUP_START || kind == MARKUP_EMPTY) {
+            std::size_t pos = p - m_buf.data();
+            if (depth == 0 && pos >= next) {
+                splits.push_back(pos);
+                next = pos + step;
+            }
+            if (kind == MARKUP_START) {
+                ++depth;
+            }
+        }
+        p = q;
+    }
+}
+
+// 串行地把所有名字先加进驻留表，之后build_node()中的intern()都只是查找，可以多个线程同时进行
+std::shared_ptr<NameTable> Xml::intern_names() const {
+    auto names = std::make_shared<NameTable>();
+    for (uint32_t i = 0; i < m_view.node_count(); ++i) {
+        names->intern(m_view.str(m_view.node(i).name));
+    }
+    for (uint32_t i = 0; i < m_view.attr_count(); ++i) {
+        names->intern(m_view.str(m_view.attr(i).key));
+    }
+    return names;
+}
+
+void Xml::build_node(Node &node, uint32_t idx, unsigned nthreads) const {
+    const ViewTable::Rec &rec = m_view.node(idx);
+    node.set_name(m_view.str(rec.name));
+    node.set_text(std::string(m_view.str(rec.text)));
+    for (uint32_t i = rec.first_attr; i < rec.first_attr + rec.attr_cnt; ++i) {
+        std::string_view v = m_view.str(m_view.attr(i).value);
+        node[m_view.str(m_view.attr(i).key)].assign(v.data(), v.size());
+    }
+
+    std::vector<uint32_t> childs;
+    for (uint32_t child = rec.first_child; child != ViewTable::npos; child = m_view.node(child).next_sibling) {
+        childs.push_back(child);
+    }
+    node.reserve(childs.size());
+    if (nthreads <= 1 || childs.size() < nthreads) {
+        for (uint32_t child : childs) {
+            build_node(node.add_node(), child);
         }
-        ss << std::string(cnt, ' ') << "</" << node.get_name() << ">\n";
+        return;
+    }
+
+    // 各子树互相独立，先占好位置，再由多个线程各自生成
+    for (std::size_t i = 0; i < childs.size(); ++i) {
+        node.add_node();
+    }
+    std::atomic<std::size_t> next(0);
+    auto run = [&]() {
+        const std::size_t batch = 64;
+        std::size_t begin;
+        while ((begin = next.fetch_add(batch)) < childs.size()) {
+            std::size_t end = std::min(begin + batch, childs.size());
+            for (std::size_t i = begin; i < end; ++i) {
+                build_node(*(node.begin() + i), childs[i]);
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < nthreads; ++i) {
+        workers.emplace_back(run);
+    }
+    run();
+    for (auto &t : workers) {
+        t.join();
     }
+}
 
-    return ss.str();
+void Xml::trim() {
+    std::size_t n = m_buf.size();
+    while (n > 0 && scan::is_space(m_buf[n - 1])) {
+        --n;
+    }
+    m_buf = m_buf.substr(0, n);
 }
 
-}
\ No newline at end of file
+bool Xml::chk_1_c(char c) const {
+    return scan::is_name_1(c);
+}
+
+bool Xml::chk_c(char c) const {
+    return scan::is_name(c);
+}
+
+char Xml::get_c() {
+    seek(scan::skip_space(cur(), last()));
+    if (m_idx >= m_len) {
+        fail(ParseErrc::INCOMPLETE);
+        return '\0';
+    }
+    return m_buf[m_idx];
+}
+
+void Xml::print() {
+    Writer writer([](const char *data, std::size_t len) { std::cout.write(data, len); }, Writer::PRETTY);
+    if (m_mode == Mode::VIEW) {
+        writer.write(get_view_root());
+    } else {
+        writer.write(m_root);
+    }
+}
+
+}
@@ -2,32 +2,123 @@
 #define __YOKO_PARSER_H__
 
 #include <boost/optional.hpp>
+#include <memory>
 #include <utility>
+#include <string_view>
+#include <vector>
 #include "Node.h"
+#include "ViewNode.h"
+#include "Query.h"
+#include "ParseResult.h"
+#include "MappedFile.h"
+#include "Snapshot.h"
 
 namespace yoko {
 
 class Xml {
 public:
-    void loadFile(const std::string &filename);
-    void loadString(const std::string &str);
-    Node get_root() const { return m_root; }
+    // 两种模式都先把文档解析进平铺的结点表m_view
+    // COPY: 再由结点表生成各自保存拷贝的Node树，通过get_root()获取，之后释放结点表
+    // VIEW: 结点只保存指向文档缓冲区m_buf的string_view，不拷贝字符，通过get_view_root()获取
+    // 文本和属性值中的实体、字符引用在解析时解码，CDATA的内容原样作为文本；
+    // 只有含引用的文本、属性值才会拷贝，其他的仍然直接指向文档；不合法的引用是ParseErrc::REFERENCE错误
+    enum class Mode { COPY, VIEW };
+
+    void loadFile(const std::string &filename, Mode mode = Mode::COPY);
+    void loadString(const std::string &str, Mode mode = Mode::COPY);
+    void loadString(std::string &&str, Mode mode = Mode::COPY);
+    // 不抛异常的版本，走的是同一套解析代码，出错时返回错误种类和位置，根结点为空结点。
+    // 只有内存不够之类的异常还会抛出来
+    ParseResult tryLoadFile(const std::string &filename, Mode mode = Mode::COPY);
+    ParseResult tryLoadString(const std::string &str, Mode mode = Mode::COPY);
+    ParseResult tryLoadString(std::string &&str, Mode mode = Mode::COPY);
+
+    // 二进制快照：把解析好的文档存下来，之后loadSnapshot()直接映射文件，不用再解析。
+    // VIEW模式下结点直接指向映射的快照，加载时只把结点表中的偏移和下标检查一遍，不解析也不拷贝；
+    // COPY模式下还要由快照生成Node树。
+    // 出错时抛出std::runtime_error，格式见Snapshot.h
+    void saveSnapshot(const std::string &filename) const;
+    void loadSnapshot(const std::string &filename, Mode mode = Mode::COPY);
+
+    const Node &get_root() const { return m_root; }
+    // 只在VIEW模式下有效，结点在Xml对象销毁或重新load之前有效
+    ViewNode get_view_root() const { return ViewNode(&m_view, 0); }
+    // 缩进格式输出到标准输出，写到其他地方用Writer
     void print();
 
+    // 并行解析使用的线程数，0表示使用硬件线程数，默认为1即串行解析。
+    // 多线程时大文档会在根结点的顶层子标签之间切开，各块并行解析后再按顺序拼起来
+    void set_threads(unsigned n) { m_threads = n; }
+
+    // 解析时过滤：只保留匹配filter的结点（连同它们的子树）和它们的祖先结点，
+    // 其他子树在解析时只找到结束位置就跳过，不建结点。表达式总是从文档开始匹配，
+    // 被跳过的子树只检查标签是否完整配对。设置过滤后不再并行解析
+    void set_filter(const Query &filter) { m_filter.reset(new Query(filter)); }
+    void clear_filter() { m_filter.reset(); }
+
 private:
-    void parse();
-    void parse_decl();
-    void parse_comment();
-    Node parse_node();
-    bool parse_name(Node &node);
-    bool parse_attr(Node &node);
-    bool parse_text(Node &node);
-    std::string print(Node &node, int level);
-
-    // 去掉文本前后的空白符，将多个连续空白符替换成一个' '
-    std::string purify_text(const std::string &text);
-
-    //去掉m_str后面的空白字符
+    // m_buf准备好之后的公共流程：解析，COPY模式下再生成Node树
+    ParseResult load(Mode mode);
+    // 丢掉上一篇文档的结点，开始新的一次加载
+    void reset(Mode mode);
+    // 出错或者没有根结点时，结点表中放一个空的根结点，get_view_root()总是可以用
+    void add_empty_root();
+    // 出错时抛出和以前一样的异常
+    void raise(const ParseResult &result);
+    // 记录第一个错误，位置为m_idx，总是返回false。
+    // 下面的解析函数出错时都返回false，由调用者一层层返回，不抛异常
+    bool fail(ParseErrc code);
+    bool parse();
+    bool parse_decl();
+    bool parse_comment();
+    // 被子标签隔开的多段文本，只有一段且不含引用时直接指向m_buf，出现第二段非空文本或解码出的字符时才拼接到joined中
+    struct Text {
+        ViewTable::Span span{0, 0};
+        std::string joined;
+        bool is_joined = false;
+
+        void add(std::string_view buf, ViewTable::Span s);
+        // 追加解码出来的字符，总是要拼接
+        void add_decoded(std::string_view buf, std::string_view s);
+        void add(std::string_view buf, const Text &other);
+    };
+    bool parse_cdata(Text &text);
+
+    // 解析时过滤的状态。inside表示在匹配结果的子树中，全部保留，没有设置过滤时也是这样；
+    // 否则state为结点在m_filter中的匹配状态，counter为它的子结点的位置计数
+    struct Filter {
+        Query::State state;
+        bool inside;
+        Query::Counter *counter;
+    };
+
+    // 解析一个标签，追加到m_view末尾，idx为它在结点表中的下标，被过滤掉时为npos。
+    // parent为父结点的过滤状态
+    bool parse_node(Filter parent, uint32_t &idx);
+    bool parse_open(uint32_t &idx, bool &has_content);
+    bool parse_name(uint32_t idx);
+    bool parse_attr(uint32_t idx);
+    bool parse_text(uint32_t idx, Filter filter);
+    bool parse_content(uint32_t idx, Text &text, uint32_t &last_child, bool to_end, Filter filter);
+    bool parse_close(uint32_t idx, const Text &text);
+    // 跳过被过滤掉的标签的内容，m_idx停在它的结束标签上
+    bool skip_content();
+    // 撤销下标从idx开始的结点，extra恢复到extra_size
+    void drop(uint32_t idx, std::size_t extra_size);
+    unsigned threads() const;
+    bool parse_root_parallel();
+    std::vector<std::size_t> split_root(std::size_t parts, std::size_t &root_end) const;
+    // 生成Node树之前先建好名字的驻留表
+    std::shared_ptr<NameTable> intern_names() const;
+    // 由结点表生成Node树，nthreads大于1时各子结点的子树并行生成
+    void build_node(Node &node, uint32_t idx, unsigned nthreads = 1) const;
+
+    // m_buf上[begin, end)这一段的Span
+    ViewTable::Span span(std::size_t begin, std::size_t end) const {
+        return ViewTable::Span{static_cast<uint32_t>(begin), static_cast<uint32_t>(end - begin)};
+    }
+
+    //去掉m_buf后面的空白字符
     void trim();
 
     // 检查名字首字符是否合法
@@ -36,13 +127,25 @@ private:
     // 检查名称字符是否合法
     bool chk_c(char c) const;
 
-    // 获取第一个不为空白符的字符，如果下标越界则抛出异常
+    // 获取第一个不为空白符的字符，如果下标越界则记录错误并返回'\0'
     char get_c();
+
+    // 当前位置和文档末尾的指针，给scan中的扫描函数用
+    const char *cur() const { return m_buf.data() + m_idx; }
+    const char *last() const { return m_buf.data() + m_len; }
+    void seek(const char *p) { m_idx = p - m_buf.data(); }
 private:
+    Mode m_mode = Mode::COPY;
+    unsigned m_threads = 1;
+    std::unique_ptr<Query> m_filter;
+    ParseResult m_err;
     Node m_root;
+    ViewTable m_view;
     std::string m_version;  // todo
     std::string m_encode;   // todo
-    std::string m_str;
+    std::string m_str;      // loadString时持有的文档
+    MappedFile m_map;       // loadFile时映射的文件
+    std::string_view m_buf; // 正在解析的文档，指向m_str或者m_map
     std::size_t m_idx;
     std::size_t m_len;
 };